@@ -0,0 +1,67 @@
+# Everything but main(): shared by app/, benchmarks/ and tests/,
+# built with the same flags
+DEFINES += QT_DEPRECATED_WARNINGS
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+# The NEON kernels of framemeters.cpp: 32 bit Raspbian targets the ARMv6
+# of the first Pi by default, without NEON (aarch64 always has it).
+# CONFIG+=armv6 builds for a Pi 1 or Zero.
+contains(QT_ARCH, arm):!CONFIG(armv6) {
+    QMAKE_CFLAGS   += -march=armv7-a -mfpu=neon-vfpv4
+    QMAKE_CXXFLAGS += -march=armv7-a -mfpu=neon-vfpv4
+}
+
+SOURCES += $$PWD/mainwindow.cpp
+SOURCES += $$PWD/setupdialog.cpp
+SOURCES += $$PWD/framebufferpool.cpp
+SOURCES += $$PWD/mjpegparser.cpp
+SOURCES += $$PWD/streamcapture.cpp
+SOURCES += $$PWD/simulatedmjpegsource.cpp
+SOURCES += $$PWD/outputprofile.cpp
+SOURCES += $$PWD/framepipeline.cpp
+SOURCES += $$PWD/directorywatcher.cpp
+SOURCES += $$PWD/sessioncheckpoint.cpp
+SOURCES += $$PWD/recorder.cpp
+SOURCES += $$PWD/recordersupervisor.cpp
+SOURCES += $$PWD/chunkarchive.cpp
+SOURCES += $$PWD/framepacker.cpp
+SOURCES += $$PWD/jpegmetadata.cpp
+SOURCES += $$PWD/syncnode.cpp
+SOURCES += $$PWD/clock.cpp
+SOURCES += $$PWD/gpio.cpp
+SOURCES += $$PWD/sessionreplay.cpp
+SOURCES += $$PWD/resourcegovernor.cpp
+SOURCES += $$PWD/previewrenderer.cpp
+SOURCES += $$PWD/framemeters.cpp
+SOURCES += $$PWD/configstore.cpp
+
+HEADERS += $$PWD/mainwindow.h
+HEADERS += $$PWD/setupdialog.h
+HEADERS += $$PWD/framebufferpool.h
+HEADERS += $$PWD/mjpegparser.h
+HEADERS += $$PWD/streamcapture.h
+HEADERS += $$PWD/simulatedmjpegsource.h
+HEADERS += $$PWD/outputprofile.h
+HEADERS += $$PWD/framepipeline.h
+HEADERS += $$PWD/directorywatcher.h
+HEADERS += $$PWD/sessioncheckpoint.h
+HEADERS += $$PWD/recorder.h
+HEADERS += $$PWD/recordersupervisor.h
+HEADERS += $$PWD/chunkarchive.h
+HEADERS += $$PWD/framepacker.h
+HEADERS += $$PWD/jpegmetadata.h
+HEADERS += $$PWD/syncnode.h
+HEADERS += $$PWD/clock.h
+HEADERS += $$PWD/gpio.h
+HEADERS += $$PWD/sessionreplay.h
+HEADERS += $$PWD/resourcegovernor.h
+HEADERS += $$PWD/previewrenderer.h
+HEADERS += $$PWD/framemeters.h
+HEADERS += $$PWD/configstore.h
+
+FORMS += $$PWD/mainwindow.ui
+FORMS += $$PWD/setupdialog.ui
+
+INCLUDEPATH += $$PWD
+INCLUDEPATH += /usr/local/include
+LIBS += -L"/usr/local/lib" -lpigpiod_if2
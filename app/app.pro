@@ -0,0 +1,20 @@
+QT += core
+QT += gui
+QT += widgets
+QT += concurrent
+QT += network
+
+TARGET = ImageSequence
+TEMPLATE = app
+
+CONFIG += c++14
+
+SOURCES += $$PWD/../main.cpp
+
+include(../ImageSequence.pri)
+
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
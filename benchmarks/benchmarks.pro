@@ -0,0 +1,38 @@
+QT += core
+QT += gui
+QT += widgets
+QT += concurrent
+QT += network
+QT += testlib
+
+TARGET = benchmarks
+TEMPLATE = app
+
+CONFIG += c++14
+CONFIG += console
+
+# The application, but its main()
+include(../ImageSequence.pri)
+
+SOURCES += main.cpp
+SOURCES += testframes.cpp
+SOURCES += metadatabenchmark.cpp
+SOURCES += capturebenchmark.cpp
+SOURCES += gpiobenchmark.cpp
+SOURCES += thumbnailbenchmark.cpp
+SOURCES += kernelbenchmark.cpp
+SOURCES += chunkbenchmark.cpp
+SOURCES += replaybenchmark.cpp
+SOURCES += governorbenchmark.cpp
+SOURCES += configbenchmark.cpp
+
+HEADERS += testframes.h
+HEADERS += metadatabenchmark.h
+HEADERS += capturebenchmark.h
+HEADERS += gpiobenchmark.h
+HEADERS += thumbnailbenchmark.h
+HEADERS += kernelbenchmark.h
+HEADERS += chunkbenchmark.h
+HEADERS += replaybenchmark.h
+HEADERS += governorbenchmark.h
+HEADERS += configbenchmark.h
@@ -0,0 +1,82 @@
+#include "capturebenchmark.h"
+#include <QtTest>
+#include "clock.h"
+#include "framebufferpool.h"
+#include "streamcapture.h"
+#include "simulatedmjpegsource.h"
+#include "recordersupervisor.h"
+#include "recorder.h"
+#include "testframes.h"
+
+
+#define STREAM_FPS 30
+
+
+void
+CaptureBenchmark::initTestCase() {
+    QVERIFY(tmpDir.isValid());
+}
+
+
+void
+CaptureBenchmark::streamTrigger() {
+    VirtualClock clock(0);
+    FrameBufferPool pool(6, 2*1024*1024);
+    SimulatedMjpegSource source(STREAM_FPS, &clock);
+    QVERIFY(source.setCannedStream(TestFrames::mjpegStream(8, 1920, 1080)));
+    StreamCapture capture(&pool);
+    int nCaptured = 0;
+    connect(&capture, &StreamCapture::frameCaptured, [&](FrameBuffer* pFrame) {
+        nCaptured++;
+        pool.release(pFrame);
+    });
+    capture.start(&source);
+
+    QBENCHMARK {
+        int nBefore = nCaptured;
+        QVERIFY(capture.grabNextFrame());
+        while(nCaptured == nBefore)
+            QVERIFY(clock.advance());
+    }
+    capture.stop();
+    QCOMPARE(pool.available(), 6);// Nothing leaked
+}
+
+
+void
+CaptureBenchmark::stillTrigger() {
+    VirtualClock clock(0);
+    RecorderSupervisor supervisor(&clock);
+    QString sDir = tmpDir.path();
+    supervisor.setFactory([&clock, sDir](QObject* pParent) {
+        SimulatedRecorder* pRecorder = new SimulatedRecorder(sDir,
+                                                             QString("still"),
+                                                             STREAM_FPS,
+                                                             false,
+                                                             &clock,
+                                                             pParent);
+        pRecorder->setStartupTime(0);
+        return pRecorder;
+    });
+    bool bReady = false;
+    connect(&supervisor, &RecorderSupervisor::recorderReady, [&bReady]() {
+        bReady = true;
+    });
+    supervisor.start();
+    while(clock.advance())// Active and standby instances up
+        ;
+    QVERIFY(bReady);
+
+    QDir dir(sDir);
+    int nBefore = dir.entryList(QDir::Files).size();
+    int nTriggers = 0;
+    QBENCHMARK {
+        QVERIFY(supervisor.trigger());
+        QVERIFY(clock.advance());// The exposure
+        supervisor.frameArrived();
+        nTriggers++;
+    }
+    QCOMPARE(dir.entryList(QDir::Files).size() - nBefore, nTriggers);
+    QCOMPARE(supervisor.incidents(), 0);
+    supervisor.shutdown();
+}
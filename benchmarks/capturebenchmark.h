@@ -0,0 +1,23 @@
+#ifndef CAPTUREBENCHMARK_H
+#define CAPTUREBENCHMARK_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+
+// From the trigger to the frame in hand, with the simulated camera on a
+// VirtualClock: what is measured is our own overhead, not the exposure.
+class CaptureBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void streamTrigger();   // Continuous: grab request -> frame in a buffer
+    void stillTrigger();    // Stills: trigger -> file in the staging folder
+
+private:
+    QTemporaryDir tmpDir;
+};
+
+#endif // CAPTUREBENCHMARK_H
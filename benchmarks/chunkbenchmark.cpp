@@ -0,0 +1,81 @@
+#include "chunkbenchmark.h"
+#include <QtTest>
+#include "chunkarchive.h"
+
+
+#define LOOKUP_FRAMES 4096
+#define LOOKUP_SIZE   1024
+#define CHUNK_FRAMES  256
+
+
+void
+ChunkBenchmark::initTestCase() {
+    QVERIFY(tmpDir.isValid());
+    // Every other frame is missing, as after a recorder incident
+    sLookupChunk = tmpDir.filePath("lookup.isq");
+    QByteArray frame(LOOKUP_SIZE, 'x');
+    ChunkWriter writer;
+    QVERIFY(writer.open(sLookupChunk, 0));
+    for(int i=0; i<LOOKUP_FRAMES; i+=2)
+        QVERIFY(writer.append(i, frame.constData(), frame.size()));
+    QVERIFY(writer.commit());
+}
+
+
+void
+ChunkBenchmark::append_data() {
+    QTest::addColumn<int>("frameSize");
+    QTest::newRow("preview-64KB") << 64*1024;
+    QTest::newRow("frame-1MB")    << 1024*1024;
+}
+
+
+// A new chunk every CHUNK_FRAMES, committed and thrown away: the
+// commit (index, footer, rename) is part of the cost of a frame.
+void
+ChunkBenchmark::append() {
+    QFETCH(int, frameSize);
+    QByteArray frame(frameSize, 'x');
+    QString sFileName = tmpDir.filePath("append.isq");
+    ChunkWriter writer;
+    int frameNum = 0;
+    QBENCHMARK {
+        if(!writer.isOpen())
+            QVERIFY(writer.open(sFileName, frameNum));
+        QVERIFY(writer.append(frameNum, frame.constData(), frame.size()));
+        frameNum++;
+        if(frameNum % CHUNK_FRAMES == 0) {
+            QVERIFY(writer.commit());
+            QFile::remove(sFileName);
+        }
+    }
+    writer.cancel();
+}
+
+
+void
+ChunkBenchmark::open() {
+    ChunkReader reader;
+    QBENCHMARK {
+        QVERIFY(reader.open(sLookupChunk));
+        reader.close();
+    }
+}
+
+
+void
+ChunkBenchmark::lookup() {
+    ChunkReader reader;
+    QVERIFY(reader.open(sLookupChunk));
+    QCOMPARE(reader.frameCount(), LOOKUP_FRAMES-1);
+    quint32 seed = 1;
+    qint64 nBytes = 0;
+    QBENCHMARK {
+        seed = seed*1664525 + 1013904223;
+        int frameNum = int((seed >> 8) % (LOOKUP_FRAMES-1));
+        nBytes += reader.frame(frameNum).size();
+    }
+    QVERIFY(nBytes > 0);
+    QCOMPARE(reader.frame(2).size(), LOOKUP_SIZE);
+    QVERIFY(reader.frame(1).isEmpty());
+}
@@ -0,0 +1,26 @@
+#ifndef CHUNKBENCHMARK_H
+#define CHUNKBENCHMARK_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+
+// The chunk archives: appending frames to the current chunk and finding
+// a frame back through the index.
+class ChunkBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void append_data();
+    void append();
+    void open();
+    void lookup();
+
+private:
+    QTemporaryDir tmpDir;
+    QString       sLookupChunk;
+};
+
+#endif // CHUNKBENCHMARK_H
@@ -0,0 +1,51 @@
+#include "configbenchmark.h"
+#include <QtTest>
+#include "configstore.h"
+#include "clock.h"
+
+
+void
+ConfigBenchmark::initTestCase() {
+    QVERIFY(configDir.isValid());
+}
+
+
+// Validated and notified, nothing written: the virtual clock stands still
+void
+ConfigBenchmark::setValue() {
+    VirtualClock clock(0);
+    ConfigStore store(&clock, configDir.filePath("setValue.conf"));
+    int i = 0;
+    QBENCHMARK {
+        store.setValue(Config::Interval, MIN_INTERVAL + (i++ % 1000));
+    }
+    QCOMPARE(store.writes(), 0);
+}
+
+
+void
+ConfigBenchmark::flush_data() {
+    QTest::addColumn<int>("nChanges");
+    QTest::newRow("changes-1")    << 1;
+    QTest::newRow("changes-100")  << 100;
+    QTest::newRow("changes-1000") << 1000;
+}
+
+
+// Every flush is one atomic rewrite of the file
+void
+ConfigBenchmark::flush() {
+    QFETCH(int, nChanges);
+    VirtualClock clock(0);
+    ConfigStore store(&clock, configDir.filePath("flush.conf"));
+    int i = 0;
+    int nFlushes = 0;
+    QBENCHMARK {
+        for(int j=0; j<nChanges; j++)
+            store.setValue(Config::TotalTime, i++);
+        store.flush();
+        nFlushes++;
+    }
+    QTRY_COMPARE(store.writes(), nFlushes);
+}
+
@@ -0,0 +1,24 @@
+#ifndef CONFIGBENCHMARK_H
+#define CONFIGBENCHMARK_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+
+// The ConfigStore: what a change costs the GUI thread and what a write
+// costs the file thread.
+class ConfigBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void setValue();
+    void flush_data();
+    void flush();
+
+private:
+    QTemporaryDir configDir;
+};
+
+#endif // CONFIGBENCHMARK_H
@@ -0,0 +1,49 @@
+#include "governorbenchmark.h"
+#include <QtTest>
+#include "resourcegovernor.h"
+#include "clock.h"
+
+
+void
+GovernorBenchmark::initTestCase() {
+    QVERIFY(sysRoot.isValid());
+    QDir root(sysRoot.path());
+    QVERIFY(root.mkpath("sys/class/thermal/thermal_zone0"));
+    QVERIFY(root.mkpath("sys/class/thermal/thermal_zone1"));
+    QVERIFY(root.mkpath("proc"));
+    setTemperature(45.0);
+    setLoad(0.2);
+}
+
+
+void
+GovernorBenchmark::setTemperature(double celsius) {
+    QFile zone0(sysRoot.filePath("sys/class/thermal/thermal_zone0/temp"));
+    QVERIFY(zone0.open(QIODevice::WriteOnly));
+    zone0.write(QByteArray::number(int(celsius*1000.0)) + "\n");
+    QFile zone1(sysRoot.filePath("sys/class/thermal/thermal_zone1/temp"));
+    QVERIFY(zone1.open(QIODevice::WriteOnly));
+    zone1.write("30000\n");// Only the hottest counts
+}
+
+
+void
+GovernorBenchmark::setLoad(double load) {
+    QFile file(sysRoot.filePath("proc/loadavg"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray::number(load*QThread::idealThreadCount(), 'f', 2) +
+               " 0.50 0.40 1/123 4567\n");
+}
+
+
+void
+GovernorBenchmark::sample() {
+    VirtualClock clock(0);
+    ResourceGovernor governor(&clock, sysRoot.path());
+    QBENCHMARK {
+        governor.sample();
+    }
+    QCOMPARE(governor.level(), ResourceGovernor::Normal);
+    QCOMPARE(governor.stats().maxTemperature, 45.0);
+}
+
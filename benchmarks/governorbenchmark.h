@@ -0,0 +1,25 @@
+#ifndef GOVERNORBENCHMARK_H
+#define GOVERNORBENCHMARK_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+
+// The ResourceGovernor on a fake /sys and /proc: what a sample costs.
+class GovernorBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void sample();
+
+private:
+    void setTemperature(double celsius);
+    void setLoad(double load);
+
+private:
+    QTemporaryDir sysRoot;
+};
+
+#endif // GOVERNORBENCHMARK_H
@@ -0,0 +1,79 @@
+#include "gpiobenchmark.h"
+#include <QtTest>
+#include <pigpiod_if2.h>
+
+
+#define LED_PIN  23 // As in MainWindow
+#define PAN_PIN  14 // As in setupDialog
+
+
+GpioBenchmark::GpioBenchmark()
+    : clock(0)
+    , simulatedGpio(&clock)
+{
+}
+
+
+void
+GpioBenchmark::initTestCase() {
+    QVERIFY(simulatedGpio.start() >= 0);
+    QCOMPARE(simulatedGpio.setMode(LED_PIN, PI_OUTPUT), 0);
+    if(pigpioGpio.start() >= 0) {
+        QVERIFY(pigpioGpio.setMode(LED_PIN, PI_OUTPUT) >= 0);
+        QVERIFY(pigpioGpio.setPwmFrequency(PAN_PIN, 50) >= 0);
+    }
+}
+
+
+void
+GpioBenchmark::cleanupTestCase() {
+    if(pigpioGpio.isConnected()) {
+        pigpioGpio.write(LED_PIN, 0);
+        pigpioGpio.setPwmFrequency(PAN_PIN, 0);
+    }
+    pigpioGpio.stop();
+    simulatedGpio.stop();
+}
+
+
+void
+GpioBenchmark::simulatedWrite() {
+    unsigned level = 0;
+    QBENCHMARK {
+        level ^= 1;
+        simulatedGpio.write(LED_PIN, level);
+    }
+}
+
+
+void
+GpioBenchmark::simulatedServo() {
+    unsigned pulseWidth = 1000;
+    QBENCHMARK {
+        pulseWidth = (pulseWidth == 2000) ? 1000 : pulseWidth+1;
+        simulatedGpio.setServoPulseWidth(PAN_PIN, pulseWidth);
+    }
+}
+
+
+void
+GpioBenchmark::pigpioWrite() {
+    if(!pigpioGpio.isConnected())
+        QSKIP("pigpiod is not running");
+    unsigned level = 0;
+    QBENCHMARK {
+        level ^= 1;
+        QVERIFY(pigpioGpio.write(LED_PIN, level) >= 0);
+    }
+}
+
+
+// Always the same width: the servo does not move
+void
+GpioBenchmark::pigpioServo() {
+    if(!pigpioGpio.isConnected())
+        QSKIP("pigpiod is not running");
+    QBENCHMARK {
+        QVERIFY(pigpioGpio.setServoPulseWidth(PAN_PIN, 1500) >= 0);
+    }
+}
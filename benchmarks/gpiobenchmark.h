@@ -0,0 +1,32 @@
+#ifndef GPIOBENCHMARK_H
+#define GPIOBENCHMARK_H
+
+#include <QObject>
+#include "clock.h"
+#include "gpio.h"
+
+
+// Cost of a GPIO command: through pigpiod (a socket round trip, skipped
+// when the daemon is not running) and through the stand-in.
+class GpioBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    GpioBenchmark();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void simulatedWrite();
+    void simulatedServo();
+    void pigpioWrite();
+    void pigpioServo();
+
+private:
+    VirtualClock  clock;
+    SimulatedGpio simulatedGpio;
+    PigpioGpio    pigpioGpio;
+};
+
+#endif // GPIOBENCHMARK_H
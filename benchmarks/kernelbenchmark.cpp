@@ -0,0 +1,184 @@
+#include "kernelbenchmark.h"
+#include <QtTest>
+#include "mjpegparser.h"
+#include "jpegmetadata.h"
+#include "framemeters.h"
+#include "testframes.h"
+
+
+#define STREAM_FRAMES 16
+#define METER_WIDTH   256 // As measured by setupDialog
+
+
+void
+KernelBenchmark::initTestCase() {
+    nFrames = STREAM_FRAMES;
+    stream  = TestFrames::mjpegStream(nFrames, 1920, 1080);
+    jpeg    = TestFrames::jpeg(TestFrames::noise(2592, 1944));
+    QVERIFY(!stream.isEmpty());
+    QVERIFY(!jpeg.isEmpty());
+    qInfo() << "Stream:" << stream.size()/nFrames << "bytes per frame";
+}
+
+
+// The whole stream, in a single scan call per frame
+void
+KernelBenchmark::mjpegScan() {
+    const unsigned char* pData = reinterpret_cast<const unsigned char*>(stream.constData());
+    MjpegParser parser;
+    QBENCHMARK {
+        int nFound = 0;
+        int iEnd   = 0;
+        parser.reset();
+        while((iEnd = parser.scan(pData, iEnd, stream.size())) > 0) {
+            nFound++;
+            parser.reset();
+        }
+        QCOMPARE(nFound, nFrames);
+    }
+}
+
+
+void
+KernelBenchmark::jpegHeaderEnd() {
+    const uchar* pData = reinterpret_cast<const uchar*>(jpeg.constData());
+    QBENCHMARK {
+        bool bHasExif;
+        QVERIFY(JpegMetadata::headerEnd(pData, jpeg.size(), &bHasExif) > 0);
+    }
+}
+
+
+// A plain scalar loop on a 640x480 frame, one bin per luminance level:
+// the reference for any analysis done on the previews.
+void
+KernelBenchmark::histogram() {
+    QImage image = TestFrames::noise(640, 480);
+    QVector<int> bins(256);
+    QBENCHMARK {
+        bins.fill(0);
+        for(int y=0; y<image.height(); y++) {
+            const QRgb* pLine = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+            for(int x=0; x<image.width(); x++)
+                bins[qGray(pLine[x])]++;
+        }
+    }
+    int nTotal = 0;
+    for(int i=0; i<bins.size(); i++)
+        nTotal += bins[i];
+    QCOMPARE(nTotal, image.width()*image.height());
+}
+
+
+// Also a width that leaves a scalar tail on every line
+void
+KernelBenchmark::luminance_data() {
+    QTest::addColumn<bool>("bVectorized");
+    QTest::addColumn<int>("width");
+    QTest::newRow("vector")      << true  << 640;
+    QTest::newRow("scalar")      << false << 640;
+    QTest::newRow("vector-tail") << true  << 637;
+    QTest::newRow("scalar-tail") << false << 637;
+}
+
+
+// Otherwise the vector kernels are the scalar ones
+static bool
+hasVectorKernels() {
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+// A whole 640x360 preview frame
+void
+KernelBenchmark::luminance() {
+    QFETCH(bool, bVectorized);
+    QFETCH(int, width);
+    if(bVectorized && !hasVectorKernels())
+        QSKIP("Built without SSE2 or NEON");
+    QImage image = TestFrames::noise(width, 360);
+    QVector<uchar> luma(image.width()*image.height());
+    QVector<uchar> reference(luma.size());
+    QBENCHMARK {
+        for(int y=0; y<image.height(); y++) {
+            if(bVectorized)
+                MeterKernels::luminance(image.constScanLine(y),
+                                        image.width(),
+                                        luma.data()+y*image.width());
+            else
+                MeterKernels::luminanceScalar(image.constScanLine(y),
+                                              image.width(),
+                                              luma.data()+y*image.width());
+        }
+    }
+    for(int y=0; y<image.height(); y++)
+        MeterKernels::luminanceScalar(image.constScanLine(y),
+                                      image.width(),
+                                      reference.data()+y*image.width());
+    QCOMPARE(luma, reference);
+}
+
+
+void
+KernelBenchmark::laplacianVariance_data() {
+    QTest::addColumn<bool>("bVectorized");
+    QTest::addColumn<int>("width");
+    QTest::newRow("vector")      << true  << METER_WIDTH;
+    QTest::newRow("scalar")      << false << METER_WIDTH;
+    QTest::newRow("vector-tail") << true  << METER_WIDTH-5;
+    QTest::newRow("scalar-tail") << false << METER_WIDTH-5;
+}
+
+
+// On the reduced area that the meter actually measures
+void
+KernelBenchmark::laplacianVariance() {
+    QFETCH(bool, bVectorized);
+    QFETCH(int, width);
+    if(bVectorized && !hasVectorKernels())
+        QSKIP("Built without SSE2 or NEON");
+    QImage image = TestFrames::noise(width, METER_WIDTH*9/16);
+    QVector<uchar> luma(image.width()*image.height());
+    for(int y=0; y<image.height(); y++)
+        MeterKernels::luminanceScalar(image.constScanLine(y),
+                                      image.width(),
+                                      luma.data()+y*image.width());
+    double variance = 0.0;
+    QBENCHMARK {
+        variance = bVectorized ?
+                   MeterKernels::laplacianVariance(luma.constData(), image.width(), image.height()) :
+                   MeterKernels::laplacianVarianceScalar(luma.constData(), image.width(), image.height());
+    }
+    QCOMPARE(variance,
+             MeterKernels::laplacianVarianceScalar(luma.constData(), image.width(), image.height()));
+}
+
+
+void
+KernelBenchmark::frameMeters_data() {
+    QTest::addColumn<QSize>("size");
+    QTest::newRow("preview-640")  << QSize(640, 360);   // The setupDialog stream
+    QTest::newRow("full-1920")    << QSize(1920, 1080);
+}
+
+
+// What the preview decoder thread spends on each frame, on top of the
+// decoding: to be compared with the preview interval (66 ms at 15 fps)
+void
+KernelBenchmark::frameMeters() {
+    QFETCH(QSize, size);
+    QImage image = TestFrames::noise(size.width(), size.height());
+    FrameMeter meter(METER_WIDTH);
+    FrameMeters meters;
+    QVERIFY(meter.measure(image, &meters));// Buffers allocated here
+    QBENCHMARK {
+        meter.measure(image, &meters);
+    }
+    QCOMPARE(meters.nPixels, meter.measuredSize().width()*meter.measuredSize().height());
+    QVERIFY(meters.sharpness > 0.0);
+    qInfo() << "Measured" << meter.measuredSize() << "of" << size;
+}
@@ -0,0 +1,31 @@
+#ifndef KERNELBENCHMARK_H
+#define KERNELBENCHMARK_H
+
+#include <QObject>
+
+
+// The loops that walk every byte (or pixel) of every frame
+class KernelBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void mjpegScan();       // Frame boundaries in the camera stream
+    void jpegHeaderEnd();   // Where the metadata are spliced in
+    void histogram();       // Luminance of a preview sized frame
+    // The framing assist (setupDialog): vectorized and scalar
+    void luminance_data();
+    void luminance();
+    void laplacianVariance_data();
+    void laplacianVariance();
+    void frameMeters_data();
+    void frameMeters();     // All of it, per frame
+
+private:
+    QByteArray stream;
+    QByteArray jpeg;
+    int        nFrames;
+};
+
+#endif // KERNELBENCHMARK_H
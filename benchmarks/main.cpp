@@ -0,0 +1,149 @@
+#include <QApplication>
+#include <QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSysInfo>
+#include <QXmlStreamReader>
+#include "metadatabenchmark.h"
+#include "capturebenchmark.h"
+#include "gpiobenchmark.h"
+#include "thumbnailbenchmark.h"
+#include "kernelbenchmark.h"
+#include "chunkbenchmark.h"
+#include "replaybenchmark.h"
+#include "governorbenchmark.h"
+#include "configbenchmark.h"
+
+
+// Every benchmark class runs with the QTest XML logger (besides the
+// usual text on the console) and its results are collected in a single
+// JSON file, to be compared between releases:
+//
+//   benchmarks [--json file] [--only Class]... [QTest options]
+//
+//   { "qt": "5.15.2", "date": "...", "host": "...", "cpu": "arm",
+//     "results": [ { "benchmark": "ChunkBenchmark", "function": "append",
+//                    "tag": "frame-1MB", "metric": "WalltimeMilliseconds",
+//                    "value": 1.53, "iterations": 64 }, ... ],
+//     "failures": [ "ReplayBenchmark::session(stills-2s)", ... ] }
+//
+// The values are per iteration.
+
+
+static void
+collectResults(const QString& sXmlFile,
+               const QString& sBenchmark,
+               QJsonArray* pResults,
+               QJsonArray* pFailures)
+{
+    QFile file(sXmlFile);
+    if(!file.open(QIODevice::ReadOnly)) {
+        pFailures->append(QString("%1: no results").arg(sBenchmark));
+        return;
+    }
+    QXmlStreamReader xml(&file);
+    QString sFunction;
+    while(!xml.atEnd()) {
+        if(xml.readNext() != QXmlStreamReader::StartElement)
+            continue;
+        QXmlStreamAttributes attributes = xml.attributes();
+        if(xml.name() == QLatin1String("TestFunction")) {
+            sFunction = attributes.value("name").toString();
+        }
+        else if(xml.name() == QLatin1String("BenchmarkResult")) {
+            QJsonObject result;
+            result["benchmark"]  = sBenchmark;
+            result["function"]   = sFunction;
+            result["tag"]        = attributes.value("tag").toString();
+            result["metric"]     = attributes.value("metric").toString();
+            result["value"]      = attributes.value("value").toDouble();
+            result["iterations"] = attributes.value("iterations").toInt();
+            pResults->append(result);
+        }
+        else if(xml.name() == QLatin1String("Incident")) {
+            QStringRef type = attributes.value("type");
+            if(type == QLatin1String("fail") || type == QLatin1String("xpass"))
+                pFailures->append(QString("%1::%2").arg(sBenchmark).arg(sFunction));
+        }
+    }
+    if(xml.hasError())
+        pFailures->append(QString("%1: %2").arg(sBenchmark).arg(xml.errorString()));
+}
+
+
+int
+main(int argc, char *argv[]) {
+    // The session replays build the main window: no display needed
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    // Never touch the settings of the real application
+    app.setApplicationName(QString("ImageSequence-benchmarks"));
+
+    QString sJsonFile = QString("benchmarks.json");
+    QStringList only;
+    QStringList testArguments;
+    QStringList arguments = app.arguments();
+    testArguments << arguments.first();
+    for(int i=1; i<arguments.size(); i++) {
+        if(arguments[i] == QString("--json") && i+1 < arguments.size())
+            sJsonFile = arguments[++i];
+        else if(arguments[i] == QString("--only") && i+1 < arguments.size())
+            only << arguments[++i];
+        else
+            testArguments << arguments[i];
+    }
+
+    QTemporaryDir xmlDir;
+    if(!xmlDir.isValid()) {
+        qCritical() << "Unable to create a temporary folder";
+        return 1;
+    }
+    QList<QObject*> benchmarks;
+    benchmarks << new MetadataBenchmark
+               << new CaptureBenchmark
+               << new GpioBenchmark
+               << new ThumbnailBenchmark
+               << new KernelBenchmark
+               << new ChunkBenchmark
+               << new ReplayBenchmark
+               << new GovernorBenchmark
+               << new ConfigBenchmark;
+
+    QJsonArray results;
+    QJsonArray failures;
+    int nFailed = 0;
+    for(int i=0; i<benchmarks.size(); i++) {
+        QString sName = QString(benchmarks[i]->metaObject()->className());
+        if(!only.isEmpty() && !only.contains(sName))
+            continue;
+        QString sXmlFile = xmlDir.filePath(sName + QString(".xml"));
+        QStringList benchmarkArguments = testArguments;
+        benchmarkArguments << QString("-o") << sXmlFile + QString(",xml")
+                           << QString("-o") << QString("-,txt");
+        nFailed += QTest::qExec(benchmarks[i], benchmarkArguments);
+        collectResults(sXmlFile, sName, &results, &failures);
+    }
+    qDeleteAll(benchmarks);
+
+    QJsonObject json;
+    json["qt"]       = QString(qVersion());
+    json["date"]     = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    json["host"]     = QSysInfo::machineHostName();
+    json["cpu"]      = QSysInfo::currentCpuArchitecture();
+    json["kernel"]   = QSysInfo::kernelVersion();
+    json["results"]  = results;
+    json["failures"] = failures;
+    QSaveFile file(sJsonFile);
+    if(!file.open(QIODevice::WriteOnly) ||
+       file.write(QJsonDocument(json).toJson()) < 0 ||
+       !file.commit())
+    {
+        qCritical() << "Unable to write" << sJsonFile;
+        return 1;
+    }
+    qInfo() << results.size() << "results written to" << sJsonFile;
+    return (nFailed == 0) ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#include "metadatabenchmark.h"
+#include <QtTest>
+#include "testframes.h"
+
+
+void
+MetadataBenchmark::initTestCase() {
+    QVERIFY(tmpDir.isValid());
+    // About 5 MB, like a full resolution frame
+    jpeg = TestFrames::jpeg(TestFrames::noise(2592, 1944));
+    QVERIFY(!jpeg.isEmpty());
+    qInfo() << "Test frame:" << jpeg.size() << "bytes";
+
+    sSourceFile = tmpDir.filePath("source.jpg");
+    QFile file(sSourceFile);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(jpeg), qint64(jpeg.size()));
+    file.close();
+
+    metadata.sSessionId     = QString("{5e3b9c1a-2f64-4a8e-9d1b-0c7f2a6e4b13}");
+    metadata.frameNum       = 1234;
+    metadata.msecScheduled  = QDateTime::currentMSecsSinceEpoch();
+    metadata.msecTriggered  = metadata.msecScheduled + 7;
+    metadata.bLampOn        = true;
+    metadata.panPulseWidth  = 1400;
+    metadata.tiltPulseWidth = 1500;
+}
+
+
+void
+MetadataBenchmark::segments() {
+    QBENCHMARK {
+        QByteArray app1 = JpegMetadata::segments(metadata, true);
+        Q_UNUSED(app1)
+    }
+}
+
+
+void
+MetadataBenchmark::writeFromMemory() {
+    QString sFileName = tmpDir.filePath("memory.jpg");
+    QBENCHMARK {
+        QVERIFY(JpegMetadata::write(sFileName, jpeg.constData(), jpeg.size(), metadata));
+    }
+    QFile file(sFileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY(file.size() > jpeg.size());
+}
+
+
+void
+MetadataBenchmark::copyFile() {
+    QString sFileName = tmpDir.filePath("copy.jpg");
+    QBENCHMARK {
+        QVERIFY(JpegMetadata::copy(sSourceFile, sFileName, metadata));
+    }
+    QFile file(sFileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray result = file.readAll();
+    // Headers, then our segments, then exactly the original data
+    bool bHasExif;
+    int iSplice = JpegMetadata::headerEnd(reinterpret_cast<const uchar*>(jpeg.constData()),
+                                          jpeg.size(),
+                                          &bHasExif);
+    QVERIFY(iSplice > 0);
+    QVERIFY(result.startsWith(jpeg.left(iSplice)));
+    QVERIFY(result.endsWith(jpeg.mid(iSplice)));
+}
+
@@ -0,0 +1,27 @@
+#ifndef METADATABENCHMARK_H
+#define METADATABENCHMARK_H
+
+#include <QObject>
+#include <QTemporaryDir>
+#include "jpegmetadata.h"
+
+
+// Per frame cost of the metadata injection on a camera sized JPEG
+class MetadataBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void segments();
+    void writeFromMemory();
+    void copyFile();
+
+private:
+    QTemporaryDir tmpDir;
+    QByteArray    jpeg;
+    QString       sSourceFile;
+    FrameMetadata metadata;
+};
+
+#endif // METADATABENCHMARK_H
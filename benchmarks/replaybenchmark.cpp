@@ -0,0 +1,49 @@
+#include "replaybenchmark.h"
+#include <QtTest>
+#include "sessionreplay.h"
+
+
+// About the same number of frames for every interval, then whole days,
+// then recorders that crash or hang after n frames (every new recorder
+// counts its own: they fail again and again). Whether the recovery works
+// is for ReplayTest: here, what it costs.
+void
+ReplayBenchmark::session_data() {
+    QTest::addColumn<int>("msecInterval");
+    QTest::addColumn<int>("secDuration");
+    QTest::addColumn<bool>("bContinuous");
+    QTest::addColumn<int>("crashAfter");
+    QTest::addColumn<int>("hangAfter");
+    QTest::newRow("stills-2s")          << 2000  << 1200  << false << 0    << 0;
+    QTest::newRow("stills-10s")         << 10000 << 6000  << false << 0    << 0;
+    QTest::newRow("stills-60s")         << 60000 << 36000 << false << 0    << 0;
+    QTest::newRow("continuous-500ms")   << 500   << 300   << true  << 0    << 0;
+    QTest::newRow("continuous-2s")      << 2000  << 1200  << true  << 0    << 0;
+    QTest::newRow("stills-10s-24h")     << 10000 << 86400 << false << 0    << 0;
+    QTest::newRow("continuous-10s-24h") << 10000 << 86400 << true  << 0    << 0;
+    QTest::newRow("stills-crash")       << 10000 << 6000  << false << 100  << 0;
+    QTest::newRow("stills-hang")        << 10000 << 6000  << false << 0    << 100;
+    QTest::newRow("continuous-crash")   << 2000  << 1200  << true  << 100  << 0;
+    QTest::newRow("continuous-hang")    << 2000  << 1200  << true  << 0    << 100;
+}
+
+
+void
+ReplayBenchmark::session() {
+    QFETCH(int, msecInterval);
+    QFETCH(int, secDuration);
+    QFETCH(bool, bContinuous);
+    QFETCH(int, crashAfter);
+    QFETCH(int, hangAfter);
+    SessionReplay replay(msecInterval, secDuration, bContinuous);
+    replay.setCrashAfter(crashAfter);
+    replay.setHangAfter(hangAfter);
+    ReplayReport report;
+    bool bPassed = replay.run(&report);
+    QVERIFY2(bPassed, qPrintable(report.failures.join(QString("; "))));
+    qInfo() << report.nTriggers << "frames,"
+            << report.msecWallTime << "ms,"
+            << "max lateness" << report.msecMaxLateness << "ms,"
+            << report.nIncidents << "recorder incidents";
+    QTest::setBenchmarkResult(report.usecPerFrame/1000.0, QTest::WalltimeMilliseconds);
+}
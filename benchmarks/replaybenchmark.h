@@ -0,0 +1,21 @@
+#ifndef REPLAYBENCHMARK_H
+#define REPLAYBENCHMARK_H
+
+#include <QObject>
+
+
+// Whole sessions of the application with the simulated camera, replayed
+// on a VirtualClock (see SessionReplay). The result is the wall time
+// spent per frame by everything but the camera: scheduling, lamp,
+// file watching, metadata and checkpoints, also with injected crashes
+// and hangs.
+class ReplayBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void session_data();
+    void session();
+};
+
+#endif // REPLAYBENCHMARK_H
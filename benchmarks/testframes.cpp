@@ -0,0 +1,40 @@
+#include "testframes.h"
+#include <QBuffer>
+
+
+QImage
+TestFrames::noise(int width, int height) {
+    QImage image(width, height, QImage::Format_RGB32);
+    quint32 seed = 1;
+    for(int y=0; y<image.height(); y++) {
+        QRgb* pLine = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for(int x=0; x<image.width(); x++) {
+            seed = seed*1664525 + 1013904223;
+            pLine[x] = seed >> 8;
+        }
+    }
+    return image;
+}
+
+
+QByteArray
+TestFrames::jpeg(const QImage& image, int quality) {
+    QByteArray jpegData;
+    QBuffer buffer(&jpegData);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "JPG", quality);
+    return jpegData;
+}
+
+
+// Like raspivid: the frames one after the other, nothing in between
+QByteArray
+TestFrames::mjpegStream(int nFrames, int width, int height) {
+    QImage image = noise(width, height);
+    QByteArray stream;
+    for(int i=0; i<nFrames; i++) {
+        image.setPixel(i % width, 0, qRgb(255, 255, 255));// Not twice the same
+        stream.append(jpeg(image, 80));
+    }
+    return stream;
+}
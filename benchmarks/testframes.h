@@ -0,0 +1,18 @@
+#ifndef TESTFRAMES_H
+#define TESTFRAMES_H
+
+#include <QImage>
+#include <QByteArray>
+
+
+// Synthetic camera frames, always the same for a given size.
+// Noise does not compress: the JPEGs are as large as the ones of a
+// detailed scene (about 5 MB at full resolution).
+namespace TestFrames
+{
+    QImage     noise(int width, int height);
+    QByteArray jpeg(const QImage& image, int quality = 75);
+    QByteArray mjpegStream(int nFrames, int width, int height);
+}
+
+#endif // TESTFRAMES_H
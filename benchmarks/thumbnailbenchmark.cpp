@@ -0,0 +1,104 @@
+#include "thumbnailbenchmark.h"
+#include <QtTest>
+#include <QBuffer>
+#include <QImageReader>
+#include "framepipeline.h"
+#include "previewrenderer.h"
+#include "testframes.h"
+
+
+// Just to reach encodeProfiles()
+class BenchmarkPipeline : public FramePipeline
+{
+public:
+    BenchmarkPipeline()
+        : FramePipeline(Q_NULLPTR)
+    {
+    }
+    using FramePipeline::encodeProfiles;
+};
+
+
+void
+ThumbnailBenchmark::initTestCase() {
+    QVERIFY(tmpDir.isValid());
+    jpeg = TestFrames::jpeg(TestFrames::noise(2592, 1944));
+    QVERIFY(!jpeg.isEmpty());
+    metadata.sSessionId     = QString("{5e3b9c1a-2f64-4a8e-9d1b-0c7f2a6e4b13}");
+    metadata.frameNum       = 1;
+    metadata.msecScheduled  = 0;
+    metadata.msecTriggered  = 0;
+    metadata.bLampOn        = true;
+    metadata.panPulseWidth  = 1500;
+    metadata.tiltPulseWidth = 1500;
+}
+
+
+void
+ThumbnailBenchmark::decode() {
+    QBENCHMARK {
+        QImage image;
+        QVERIFY(image.loadFromData(jpeg, "JPG"));
+    }
+}
+
+
+void
+ThumbnailBenchmark::scaledDecode() {
+    QBENCHMARK {
+        QBuffer buffer(&jpeg);
+        QImageReader reader(&buffer, "jpg");
+        reader.setScaledSize(QSize(324, 243));
+        QImage image = reader.read();
+        QVERIFY(!image.isNull());
+    }
+}
+
+
+// In this thread: submit, decode and take it as the GUI would
+void
+ThumbnailBenchmark::previewDecode() {
+    PreviewDecoder decoder(QSize(320, 240), jpeg.size());
+    QBENCHMARK {
+        QVERIFY(decoder.submit(jpeg.constData(), jpeg.size()));
+        decoder.decode();
+        const QImage* pImage = decoder.acquireLatest();
+        QVERIFY(pImage && !pImage->isNull());
+    }
+    QCOMPARE(decoder.droppedFrames(), 0);
+}
+
+
+void
+ThumbnailBenchmark::encodeProfile_data() {
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QRect>("roi");
+    QTest::newRow("thumb-320")    << QSize(320, 240)   << QRect();
+    QTest::newRow("web-1280")     << QSize(1280, 720)  << QRect();
+    QTest::newRow("crop-640")     << QSize()           << QRect(800, 300, 640, 480);
+    QTest::newRow("crop-scaled")  << QSize(320, 240)   << QRect(800, 300, 640, 480);
+}
+
+
+void
+ThumbnailBenchmark::encodeProfile() {
+    QFETCH(QSize, size);
+    QFETCH(QRect, roi);
+    OutputProfile profile;
+    profile.sName   = QString("profile");
+    profile.size    = size;
+    profile.roi     = roi;
+    profile.quality = 85;
+    BenchmarkPipeline pipeline;
+    pipeline.setSession(tmpDir.path(),
+                        QString("frame"),
+                        QVector<OutputProfile>() << profile);
+    int nErrors = 0;
+    connect(&pipeline, &FramePipeline::pipelineError, [&nErrors]() {
+        nErrors++;
+    });
+    QBENCHMARK {
+        pipeline.encodeProfiles(metadata, jpeg.constData(), jpeg.size());
+    }
+    QCOMPARE(nErrors, 0);
+}
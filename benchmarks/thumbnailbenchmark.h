@@ -0,0 +1,28 @@
+#ifndef THUMBNAILBENCHMARK_H
+#define THUMBNAILBENCHMARK_H
+
+#include <QObject>
+#include <QTemporaryDir>
+#include "jpegmetadata.h"
+
+
+// From a full resolution JPEG to the smaller output profiles
+class ThumbnailBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void decode();          // Baseline: the full decode every profile needs
+    void scaledDecode();    // Scaled by libjpeg while decoding
+    void previewDecode();   // Into the reused images of the preview
+    void encodeProfile_data();
+    void encodeProfile();   // What FramePipeline does for every frame
+
+private:
+    QTemporaryDir tmpDir;
+    QByteArray    jpeg;
+    FrameMetadata metadata;
+};
+
+#endif // THUMBNAILBENCHMARK_H
@@ -0,0 +1,192 @@
+#include "chunkarchive.h"
+#include <QtEndian>
+#include <QDebug>
+#include <string.h>
+
+
+#define CHUNK_MAGIC    "ISQCHUNK"
+#define INDEX_MAGIC    "ISQINDEX"
+#define CHUNK_VERSION  1
+#define HEADER_SIZE    16
+#define ENTRY_SIZE     16
+#define FOOTER_SIZE    24
+
+
+//////////////////////////////////////////////////////////////
+/// Writer <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+ChunkWriter::ChunkWriter()
+    : pFile(Q_NULLPTR)
+    , iFirstFrame(0)
+{
+}
+
+
+ChunkWriter::~ChunkWriter() {
+    cancel();
+}
+
+
+// The chunk becomes visible, under its name, only after commit()
+bool
+ChunkWriter::open(const QString& sFileName, int firstFrame) {
+    cancel();
+    pFile = new QSaveFile(sFileName);
+    if(!pFile->open(QIODevice::WriteOnly)) {
+        qWarning() << "Unable to create" << sFileName;
+        cancel();
+        return false;
+    }
+    iFirstFrame = firstFrame;
+    index.clear();
+    uchar header[HEADER_SIZE];
+    memcpy(header, CHUNK_MAGIC, 8);
+    qToLittleEndian<quint32>(CHUNK_VERSION, header+8);
+    qToLittleEndian<qint32>(firstFrame, header+12);
+    return write(reinterpret_cast<const char*>(header), HEADER_SIZE);
+}
+
+
+// Frames must come in increasing order
+bool
+ChunkWriter::append(int frameNum, const char* pData, int size) {
+    if(!pFile || (frameNum <= lastFrame()))
+        return false;
+    Entry empty = { 0, 0 };
+    while(lastFrame() < frameNum-1)// Gaps left by dropped frames
+        index.append(empty);
+    Entry entry = { quint64(pFile->pos()), quint32(size) };
+    if(!write(pData, size))
+        return false;
+    index.append(entry);
+    return true;
+}
+
+
+bool
+ChunkWriter::commit() {
+    if(!pFile)
+        return false;
+    quint64 indexOffset = quint64(pFile->pos());
+    QByteArray table(index.size()*ENTRY_SIZE, 0);
+    uchar* pEntry = reinterpret_cast<uchar*>(table.data());
+    for(int i=0; i<index.size(); i++, pEntry+=ENTRY_SIZE) {
+        qToLittleEndian<quint64>(index[i].offset, pEntry);
+        qToLittleEndian<quint32>(index[i].size, pEntry+8);
+    }
+    uchar footer[FOOTER_SIZE];
+    memset(footer, 0, FOOTER_SIZE);
+    qToLittleEndian<quint64>(indexOffset, footer);
+    qToLittleEndian<quint32>(quint32(index.size()), footer+8);
+    memcpy(footer+16, INDEX_MAGIC, 8);
+    bool bOk = write(table.constData(), table.size()) &&
+               write(reinterpret_cast<const char*>(footer), FOOTER_SIZE) &&
+               pFile->commit();
+    delete pFile;
+    pFile = Q_NULLPTR;
+    index.clear();
+    return bOk;
+}
+
+
+void
+ChunkWriter::cancel() {
+    if(!pFile)
+        return;
+    pFile->cancelWriting();
+    delete pFile;// The temporary file is removed
+    pFile = Q_NULLPTR;
+    index.clear();
+}
+
+
+qint64
+ChunkWriter::size() const {
+    return pFile ? pFile->pos() : 0;
+}
+
+
+bool
+ChunkWriter::write(const char* pData, qint64 size) {
+    return pFile->write(pData, size) == size;
+}
+
+
+//////////////////////////////////////////////////////////////
+/// Reader <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+ChunkReader::ChunkReader()
+    : pMap(Q_NULLPTR)
+    , pIndex(Q_NULLPTR)
+    , mapSize(0)
+    , iFirstFrame(0)
+    , nSlots(0)
+{
+}
+
+
+ChunkReader::~ChunkReader() {
+    close();
+}
+
+
+bool
+ChunkReader::open(const QString& sFileName) {
+    close();
+    file.setFileName(sFileName);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+    mapSize = file.size();
+    if(mapSize < HEADER_SIZE+FOOTER_SIZE) {
+        close();
+        return false;
+    }
+    pMap = file.map(0, mapSize);
+    if(!pMap) {
+        close();
+        return false;
+    }
+    const uchar* pFooter = pMap + mapSize - FOOTER_SIZE;
+    quint64 indexOffset = qFromLittleEndian<quint64>(pFooter);
+    quint32 slots       = qFromLittleEndian<quint32>(pFooter+8);
+    if(memcmp(pMap, CHUNK_MAGIC, 8) ||
+       memcmp(pFooter+16, INDEX_MAGIC, 8) ||
+       (qFromLittleEndian<quint32>(pMap+8) != CHUNK_VERSION) ||
+       (indexOffset < HEADER_SIZE) ||
+       (indexOffset + quint64(slots)*ENTRY_SIZE != quint64(mapSize - FOOTER_SIZE)))
+    {
+        qWarning() << "Invalid or incomplete chunk" << sFileName;
+        close();
+        return false;
+    }
+    iFirstFrame = qFromLittleEndian<qint32>(pMap+12);
+    nSlots      = int(slots);
+    pIndex      = pMap + indexOffset;
+    return true;
+}
+
+
+void
+ChunkReader::close() {
+    if(pMap)
+        file.unmap(const_cast<uchar*>(pMap));
+    file.close();
+    pMap    = Q_NULLPTR;
+    pIndex  = Q_NULLPTR;
+    mapSize = 0;
+    nSlots  = 0;
+}
+
+
+QByteArray
+ChunkReader::frame(int frameNum) const {
+    int iSlot = frameNum - iFirstFrame;
+    if(!pMap || (iSlot < 0) || (iSlot >= nSlots))
+        return QByteArray();
+    const uchar* pEntry = pIndex + qint64(iSlot)*ENTRY_SIZE;
+    quint64 offset = qFromLittleEndian<quint64>(pEntry);
+    quint32 size   = qFromLittleEndian<quint32>(pEntry+8);
+    if((size == 0) || (offset + size > quint64(pIndex - pMap)))
+        return QByteArray();
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(pMap + offset), int(size));
+}
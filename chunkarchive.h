@@ -0,0 +1,75 @@
+#ifndef CHUNKARCHIVE_H
+#define CHUNKARCHIVE_H
+
+#include <QFile>
+#include <QSaveFile>
+#include <QVector>
+
+
+// A chunk holds a run of consecutive frames, stored as they are (no
+// recompression), followed by an index and a footer:
+//
+//   header  "ISQCHUNK" | version (u32) | first frame (i32)
+//   frames  the JPEG bytes, one after the other
+//   index   one entry per frame slot: offset (u64) | size (u32) | 0 (u32)
+//   footer  index offset (u64) | slots (u32) | 0 (u32) | "ISQINDEX"
+//
+// All the numbers are little endian. A missing frame has size 0.
+// The footer is written last, so a chunk without a valid footer is
+// an incomplete one and is never read.
+class ChunkWriter
+{
+public:
+    ChunkWriter();
+    ~ChunkWriter();
+
+    bool open(const QString& sFileName, int firstFrame);
+    bool append(int frameNum, const char* pData, int size);
+    bool commit();
+    void cancel();
+    bool isOpen() const { return pFile != Q_NULLPTR; }
+    int  firstFrame() const { return iFirstFrame; }
+    int  lastFrame() const { return iFirstFrame + index.size() - 1; }
+    qint64 size() const;
+
+protected:
+    bool write(const char* pData, qint64 size);
+
+private:
+    struct Entry {
+        quint64 offset;
+        quint32 size;
+    };
+    QSaveFile*     pFile;
+    QVector<Entry> index;
+    int            iFirstFrame;
+};
+
+
+// Random access to the frames of a chunk.
+// The whole file is memory mapped: frame() is a lookup in the index
+// and returns the bytes in place, without copying them.
+class ChunkReader
+{
+public:
+    ChunkReader();
+    ~ChunkReader();
+
+    bool open(const QString& sFileName);
+    void close();
+    bool isOpen() const { return pMap != Q_NULLPTR; }
+    int  firstFrame() const { return iFirstFrame; }
+    int  frameCount() const { return nSlots; }
+    // Valid as long as the reader is open. Empty if missing.
+    QByteArray frame(int frameNum) const;
+
+private:
+    QFile        file;
+    const uchar* pMap;
+    const uchar* pIndex;
+    qint64       mapSize;
+    int          iFirstFrame;
+    int          nSlots;
+};
+
+#endif // CHUNKARCHIVE_H
@@ -0,0 +1,185 @@
+#include "clock.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QThread>
+
+
+ClockTimer::ClockTimer(QObject *parent)
+    : QObject(parent)
+    , bSingleShot(false)
+{
+}
+
+
+Clock::~Clock() {
+}
+
+
+Clock*
+Clock::system() {
+    static SystemClock systemClock;
+    return &systemClock;
+}
+
+
+//////////////////////////////////////////////////////////////
+/// Wall clock <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+class SystemTimer : public ClockTimer
+{
+public:
+    explicit SystemTimer(QObject *parent)
+        : ClockTimer(parent)
+    {
+        timer.setTimerType(Qt::PreciseTimer);
+        connect(&timer,
+                SIGNAL(timeout()),
+                this,
+                SIGNAL(timeout()));
+    }
+    void start(int msec) Q_DECL_OVERRIDE {
+        timer.setSingleShot(bSingleShot);
+        timer.start(msec);
+    }
+    void stop() Q_DECL_OVERRIDE          { timer.stop(); }
+    bool isActive() const Q_DECL_OVERRIDE { return timer.isActive(); }
+
+private:
+    QTimer timer;
+};
+
+
+qint64
+SystemClock::msecNow() const {
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+
+void
+SystemClock::sleep(int msec) {
+    QThread::msleep(ulong(msec));
+}
+
+
+ClockTimer*
+SystemClock::createTimer(QObject* pParent) {
+    return new SystemTimer(pParent);
+}
+
+
+//////////////////////////////////////////////////////////////
+/// Virtual clock <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+class VirtualTimer : public ClockTimer
+{
+public:
+    VirtualTimer(VirtualClock* pClock, QObject *parent)
+        : ClockTimer(parent)
+        , pClock(pClock)
+        , msecDue(-1)
+        , msecInterval(0)
+        , sequence(0)
+    {
+        pClock->add(this);
+    }
+    ~VirtualTimer() {
+        if(pClock)
+            pClock->remove(this);
+    }
+    void start(int msec) Q_DECL_OVERRIDE {
+        if(!pClock)// Outlived its clock: never fires again
+            return;
+        msecInterval = qMax(0, msec);
+        msecDue      = pClock->msecNow() + msecInterval;
+        sequence     = pClock->nextSequence();// Same deadline: first started, first fired
+    }
+    void stop() Q_DECL_OVERRIDE           { msecDue = -1; }
+    bool isActive() const Q_DECL_OVERRIDE { return msecDue >= 0; }
+
+    void fire() {
+        if(bSingleShot)
+            msecDue = -1;
+        else
+            start(qMax(1, msecInterval));
+        emit timeout();
+    }
+
+    VirtualClock* pClock;
+    qint64        msecDue;
+    int           msecInterval;
+    quint64       sequence;
+};
+
+
+VirtualClock::VirtualClock(qint64 msecStart)
+    : msecCurrent(msecStart)
+    , sequence(0)
+    , nFired(0)
+{
+}
+
+
+// The timers belong to their parents and may outlive us: they are
+// stopped and forget us
+VirtualClock::~VirtualClock() {
+    for(int i=0; i<timers.size(); i++) {
+        timers[i]->stop();
+        timers[i]->pClock = Q_NULLPTR;
+    }
+}
+
+
+void
+VirtualClock::sleep(int msec) {
+    msecCurrent += qMax(0, msec);
+}
+
+
+ClockTimer*
+VirtualClock::createTimer(QObject* pParent) {
+    return new VirtualTimer(this, pParent);
+}
+
+
+bool
+VirtualClock::advance() {
+    // Let the consequences of the last timer happen first
+    processEvents();
+    VirtualTimer* pNext = Q_NULLPTR;
+    for(int i=0; i<timers.size(); i++) {
+        VirtualTimer* pTimer = timers[i];
+        if(!pTimer->isActive())
+            continue;
+        if(!pNext ||
+           (pTimer->msecDue < pNext->msecDue) ||
+           ((pTimer->msecDue == pNext->msecDue) && (pTimer->sequence < pNext->sequence)))
+        {
+            pNext = pTimer;
+        }
+    }
+    if(!pNext)
+        return false;
+    msecCurrent = qMax(msecCurrent, pNext->msecDue);// Sleeps may have moved us past it
+    nFired++;
+    pNext->fire();
+    processEvents();
+    return true;
+}
+
+
+// processEvents() leaves the deleteLater()s to the event loop, which
+// does not run during a replay: the dismissed recorders would pile up
+void
+VirtualClock::processEvents() {
+    QCoreApplication::processEvents();
+    QCoreApplication::sendPostedEvents(Q_NULLPTR, QEvent::DeferredDelete);
+}
+
+
+void
+VirtualClock::runUntil(qint64 msecEnd) {
+    while(msecCurrent < msecEnd) {
+        if(!advance())
+            break;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <QObject>
+#include <QTimer>
+#include <QList>
+
+
+// A timer driven by a Clock. Same use as a QTimer.
+class ClockTimer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ClockTimer(QObject *parent = nullptr);
+
+    virtual void start(int msec) = 0;
+    virtual void stop() = 0;
+    virtual bool isActive() const = 0;
+    void setSingleShot(bool bSingle) { bSingleShot = bSingle; }
+    bool isSingleShot() const { return bSingleShot; }
+
+signals:
+    void timeout();
+
+protected:
+    bool bSingleShot;
+};
+
+
+// Where the time comes from.
+// Everything that schedules, waits or timestamps asks a Clock instead of
+// QDateTime/QTimer/QThread, so that the very same logic can run on the
+// wall clock or on a VirtualClock that jumps from one timer to the next.
+class Clock
+{
+public:
+    virtual ~Clock();
+
+    virtual qint64 msecNow() const = 0;  // ms since Epoch
+    virtual void sleep(int msec) = 0;
+    virtual ClockTimer* createTimer(QObject* pParent) = 0;
+
+    static Clock* system();
+};
+
+
+// The wall clock
+class SystemClock : public Clock
+{
+public:
+    qint64 msecNow() const Q_DECL_OVERRIDE;
+    void sleep(int msec) Q_DECL_OVERRIDE;
+    ClockTimer* createTimer(QObject* pParent) Q_DECL_OVERRIDE;
+};
+
+
+class VirtualTimer;
+
+
+// Time stands still until advance() fires the next due timer, moving
+// the clock to its deadline. Whatever the timers trigger in the event
+// loop (i.e. the file system notifications) is processed before moving on.
+// A day of timers runs in seconds and always in the same order.
+class VirtualClock : public Clock
+{
+public:
+    explicit VirtualClock(qint64 msecStart);
+    ~VirtualClock();
+
+    qint64 msecNow() const Q_DECL_OVERRIDE { return msecCurrent; }
+    void sleep(int msec) Q_DECL_OVERRIDE;   // Just moves the time on
+    ClockTimer* createTimer(QObject* pParent) Q_DECL_OVERRIDE;
+
+    bool advance();                         // false if no timer is active
+    void runUntil(qint64 msecEnd);
+    int  timersFired() const { return nFired; }
+
+private:
+    friend class VirtualTimer;
+    void add(VirtualTimer* pTimer)    { timers.append(pTimer); }
+    void remove(VirtualTimer* pTimer) { timers.removeAll(pTimer); }
+    quint64 nextSequence()            { return ++sequence; }
+    void processEvents();
+
+private:
+    QList<VirtualTimer*> timers;
+    qint64  msecCurrent;
+    quint64 sequence;
+    int     nFired;
+};
+
+#endif // CLOCK_H
@@ -0,0 +1,542 @@
+#include "configstore.h"
+#include <QSettings>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QFileInfo>
+#include <QDebug>
+
+
+#define COALESCE_DELAY    500   // in ms: the most that a power cut can lose
+#define RELOAD_DELAY      200   // in ms: editors save in more than one step
+
+// Defaults
+#define CHECKPOINT_FRAMES 10    // Checkpoint period (in frames)
+#define CHUNK_MBYTES      64    // Chunk archive size
+#define PACKER_KBYTES     1024  // Packer write rate (KB/s)
+#define THERMAL_WARM      65.0  // in °C (the Pi firmware throttles from 80 °C)
+#define THERMAL_HOT       75.0  // in °C
+#define LOAD_PER_CORE     1.5
+#define LATENCY_BUDGET    50    // in ms
+#define PREVIEW_FPS       10
+#define SERVO_CENTER      1400  // in us
+#define MIN_PULSE_WIDTH   500   // in us: the servo pulses that pigpio accepts
+#define MAX_PULSE_WIDTH   2500  // in us
+
+
+//////////////////////////////////////////////////////////////
+/// Settings file (its own thread) <<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+ConfigFile::ConfigFile(const QString& sFileName, const QStringList& listKeys)
+    : sFile(sFileName)
+    , arrayKeys(listKeys)
+{
+}
+
+
+// Whatever is in the file: the store decides what is valid
+QVariantMap
+ConfigFile::readAll() {
+    QVariantMap fileValues;
+    QSettings settings(sFile, QSettings::IniFormat);
+    const QStringList keys = settings.childKeys();
+    for(int i=0; i<keys.size(); i++)
+        fileValues[keys[i]] = settings.value(keys[i]);
+    const QStringList groups = settings.childGroups();
+    for(int i=0; i<arrayKeys.size(); i++) {
+        if(!groups.contains(arrayKeys[i]))
+            continue;
+        QVariantList list;
+        int nItems = settings.beginReadArray(arrayKeys[i]);
+        for(int j=0; j<nItems; j++) {
+            settings.setArrayIndex(j);
+            QVariantMap item;
+            const QStringList itemKeys = settings.childKeys();
+            for(int k=0; k<itemKeys.size(); k++)
+                item[itemKeys[k]] = settings.value(itemKeys[k]);
+            list.append(item);
+        }
+        settings.endArray();
+        fileValues[arrayKeys[i]] = list;
+    }
+    return fileValues;
+}
+
+
+void
+ConfigFile::read() {
+    emit loaded(readAll());
+}
+
+
+// Only the changed keys: QSettings merges them with the rest of the file
+void
+ConfigFile::write(const QVariantMap& changes) {
+    QSettings settings(sFile, QSettings::IniFormat);
+    settings.setAtomicSyncRequired(true);// Never rewritten in place
+    for(QVariantMap::const_iterator it=changes.constBegin(); it!=changes.constEnd(); ++it) {
+        if(!arrayKeys.contains(it.key())) {
+            settings.setValue(it.key(), it.value());
+            continue;
+        }
+        QVariantList list = it.value().toList();
+        settings.remove(it.key());// The old array could be longer
+        settings.beginWriteArray(it.key(), list.size());
+        for(int i=0; i<list.size(); i++) {
+            settings.setArrayIndex(i);
+            QVariantMap item = list[i].toMap();
+            for(QVariantMap::const_iterator field=item.constBegin(); field!=item.constEnd(); ++field)
+                settings.setValue(field.key(), field.value());
+        }
+        settings.endArray();
+    }
+    settings.sync();
+    emit written(settings.status() == QSettings::NoError);
+}
+
+
+//////////////////////////////////////////////////////////////
+/// Store (GUI thread) <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+ConfigStore::ConfigStore(Clock* pClock, const QString& sFileName, QObject *parent)
+    : QObject(parent)
+    , pClock(pClock)
+    , sFile(sFileName)
+    , nWritesInFlight(0)
+    , nWrites(0)
+{
+    declareKeys();
+    QStringList listKeys;
+    for(QHash<QString, Entry>::const_iterator it=schema.constBegin(); it!=schema.constEnd(); ++it) {
+        if(it.value().defaultValue.userType() == QMetaType::QVariantList)
+            listKeys.append(it.key());
+    }
+    pFile = new ConfigFile(sFile, listKeys);
+    apply(pFile->readAll(), false);// Still ours: no thread yet
+    pFile->moveToThread(&fileThread);
+    connect(&fileThread,
+            SIGNAL(finished()),
+            pFile,
+            SLOT(deleteLater()));
+    connect(pFile,
+            SIGNAL(written(bool)),
+            this,
+            SLOT(onWritten(bool)));
+    connect(pFile,
+            SIGNAL(loaded(QVariantMap)),
+            this,
+            SLOT(onLoaded(QVariantMap)));
+    fileThread.start();
+
+    pCoalesceTimer = pClock->createTimer(this);
+    pCoalesceTimer->setSingleShot(true);
+    connect(pCoalesceTimer,
+            SIGNAL(timeout()),
+            this,
+            SLOT(onCoalesceTimeout()));
+    pReloadTimer = pClock->createTimer(this);
+    pReloadTimer->setSingleShot(true);
+    connect(pReloadTimer,
+            SIGNAL(timeout()),
+            this,
+            SLOT(onReloadTimeout()));
+    connect(&watcher,
+            SIGNAL(fileChanged(QString)),
+            this,
+            SLOT(onFileChanged()));
+    watchFile();
+}
+
+
+ConfigStore::~ConfigStore() {
+    flush();
+    fileThread.quit();
+    fileThread.wait();
+}
+
+
+// Where QSettings has always kept them (the native format is ini on Linux).
+// One file per application name (see --instance).
+QString
+ConfigStore::defaultFileName() {
+    return QSettings().fileName();
+}
+
+
+void
+ConfigStore::declareKeys() {
+    declare(Config::BaseDir,             QStandardPaths::writableLocation(QStandardPaths::PicturesLocation));
+    declare(Config::FileName,            QString("test"));
+    declare(Config::Interval,            10000,
+            [](const QVariant& value, const QVariantMap& settings) {
+                int msecMin = Config::minInterval(settings.value(Config::Continuous.sName).toBool());
+                if(value.toInt() < msecMin)
+                    return QString("at least %1 ms").arg(msecMin);
+                return QString();
+            });
+    declare(Config::TotalTime,           0,     atLeast(0));
+    declare(Config::Continuous,          false);
+    declare(Config::SimulatedCamera,     false);
+    declare(Config::SimulatedStartup,    1500,  atLeast(0));
+    declare(Config::SimulatedCrashAfter, 0,     atLeast(0));
+    declare(Config::SimulatedHangAfter,  0,     atLeast(0));
+    declare(Config::HeartbeatTimeout,    0,     atLeast(0));
+    declare(Config::CheckpointFrames,    CHECKPOINT_FRAMES, atLeast(1));
+    declare(Config::PackFrames,          true);
+    declare(Config::ChunkSizeMB,         CHUNK_MBYTES,      atLeast(1));
+    declare(Config::PackerRateKBs,       PACKER_KBYTES,     atLeast(64));
+    declare(Config::SysfsRoot,           QString("/"));
+    declare(Config::ThermalWarm,         THERMAL_WARM,
+            [](const QVariant& value, const QVariantMap& settings) {
+                if(value.toDouble() > settings.value(Config::ThermalHot.sName).toDouble())
+                    return QString("above ThermalHot");
+                return between(20.0, 120.0)(value, settings);
+            });
+    declare(Config::ThermalHot,          THERMAL_HOT,       between(20.0, 120.0));
+    declare(Config::LoadPerCore,         LOAD_PER_CORE,     between(0.1, 100.0));
+    declare(Config::LatencyBudget,       LATENCY_BUDGET,    atLeast(1));
+    declare(Config::PreviewFps,          PREVIEW_FPS,       between(1, MAX_STREAM_FPS));
+    declare(Config::SyncMode,            QString("off"),
+            [](const QVariant& value, const QVariantMap& settings) {
+                Q_UNUSED(settings)
+                QStringList modes = QStringList() << "off" << "leader" << "follower";
+                if(!modes.contains(value.toString()))
+                    return QString("one of %1").arg(modes.join(", "));
+                if(value.toString() == "follower" &&
+                   settings.value(Config::SyncLeader.sName).toString().isEmpty())
+                    return QString("a follower needs a %1").arg(Config::SyncLeader.sName);
+                return QString();
+            });
+    declare(Config::SyncLeader,          QString(),
+            [](const QVariant& value, const QVariantMap& settings) {
+                QString sLeader = value.toString();
+                bool bFollower = settings.value(Config::SyncMode.sName).toString() == "follower";
+                if(sLeader.isEmpty() && !bFollower)
+                    return QString();
+                QStringList parts = sLeader.split(':');
+                bool bOk = true;
+                int port = parts.size() == 2 ? parts[1].toInt(&bOk) : SYNC_PORT;
+                if(parts.size() > 2 || parts[0].trimmed().isEmpty() ||
+                   !bOk || port < 1 || port > 65535)
+                    return QString("host[:port]");
+                return QString();
+            });
+    declare(Config::SyncPort,            SYNC_PORT,         between(1, 65535));
+    declare(Config::NodeName,            QSysInfo::machineHostName());
+    declare(Config::OutputProfiles,      QVariantList(),
+            [](const QVariant& value, const QVariantMap& settings) {
+                Q_UNUSED(settings)
+                QVariantList profiles = value.toList();
+                for(int i=0; i<profiles.size(); i++) {
+                    QVariantMap profile = profiles[i].toMap();
+                    if(profile.value("Name").toString().isEmpty())
+                        return QString("profile %1 has no Name").arg(i+1);
+                    int quality = profile.value("Quality", 90).toInt();
+                    if((quality < 1) || (quality > 100))
+                        return QString("profile %1: Quality between 1 and 100").arg(i+1);
+                }
+                return QString();
+            });
+    declare(Config::PanValue,            double(SERVO_CENTER), between(MIN_PULSE_WIDTH, MAX_PULSE_WIDTH));
+    declare(Config::TiltValue,           double(SERVO_CENTER), between(MIN_PULSE_WIDTH, MAX_PULSE_WIDTH));
+    declare(Config::WindowState,         QByteArray());
+}
+
+
+ConfigStore::Validator
+ConfigStore::atLeast(double min) {
+    return [min](const QVariant& value, const QVariantMap& settings) {
+        Q_UNUSED(settings)
+        if(value.toDouble() < min)
+            return QString("at least %1").arg(min);
+        return QString();
+    };
+}
+
+
+ConfigStore::Validator
+ConfigStore::between(double min, double max) {
+    return [min, max](const QVariant& value, const QVariantMap& settings) {
+        Q_UNUSED(settings)
+        if((value.toDouble() < min) || (value.toDouble() > max))
+            return QString("between %1 and %2").arg(min).arg(max);
+        return QString();
+    };
+}
+
+
+// To the type of the key (the file gives strings)
+bool
+ConfigStore::convert(const QString& sKey, QVariant* pValue) const {
+    int type = schema.value(sKey).defaultValue.userType();
+    if(pValue->userType() == type)
+        return true;
+    return pValue->convert(type);
+}
+
+
+QString
+ConfigStore::validate(const QString& sKey, const QVariant& value, const QVariantMap& settings) const {
+    QHash<QString, Entry>::const_iterator it = schema.constFind(sKey);
+    if((it == schema.constEnd()) || !it.value().validator)
+        return QString();
+    return it.value().validator(value, settings);
+}
+
+
+QString
+ConfigStore::check(const QString& sKey, const QVariant& value) const {
+    QVariantMap changes;
+    changes[sKey] = value;
+    return checkChanges(changes, Q_NULLPTR);
+}
+
+
+// Every key against all the others, as they would be: a change can make
+// another key invalid (i.e. Continuous off with a 100 ms Interval).
+// pSettings gets them, converted, if they are valid.
+QString
+ConfigStore::checkChanges(const QVariantMap& changes, QVariantMap* pSettings) const {
+    QVariantMap settings = values;
+    for(QVariantMap::const_iterator it=changes.constBegin(); it!=changes.constEnd(); ++it) {
+        if(!schema.contains(it.key()))
+            return QString("%1: unknown setting").arg(it.key());
+        QVariant converted = it.value();
+        if(!convert(it.key(), &converted))
+            return QString("%1: not a %2")
+                   .arg(it.key())
+                   .arg(QMetaType::typeName(schema[it.key()].defaultValue.userType()));
+        settings[it.key()] = converted;
+    }
+    QString sError = validateAll(settings);
+    if(sError.isEmpty() && pSettings)
+        *pSettings = settings;
+    return sError;
+}
+
+
+// The first invalid key, with the reason
+QString
+ConfigStore::validateAll(const QVariantMap& settings) const {
+    for(QHash<QString, Entry>::const_iterator it=schema.constBegin(); it!=schema.constEnd(); ++it) {
+        QString sError = validate(it.key(), settings.value(it.key()), settings);
+        if(!sError.isEmpty())
+            return QString("%1: %2").arg(it.key()).arg(sError);
+    }
+    return QString();
+}
+
+
+bool
+ConfigStore::setValue(const QString& sKey, const QVariant& value, QString* pError) {
+    QVariantMap changes;
+    changes[sKey] = value;
+    return setValues(changes, pError);
+}
+
+
+// All or nothing, and notified once all of them are stored
+bool
+ConfigStore::setValues(const QVariantMap& changes, QString* pError) {
+    QVariantMap settings;
+    QString sError = checkChanges(changes, &settings);
+    if(!sError.isEmpty()) {
+        if(pError)
+            *pError = sError;
+        return false;
+    }
+    QStringList changedKeys;
+    for(QVariantMap::const_iterator it=changes.constBegin(); it!=changes.constEnd(); ++it) {
+        if(overriddenKeys.remove(it.key()))// From now on it is remembered
+            markDirty(it.key());
+        if(values.value(it.key()) == settings[it.key()])
+            continue;
+        values[it.key()] = settings[it.key()];
+        markDirty(it.key());
+        changedKeys.append(it.key());
+    }
+    for(int i=0; i<changedKeys.size(); i++)
+        emit changed(changedKeys[i], values[changedKeys[i]]);
+    return true;
+}
+
+
+void
+ConfigStore::markDirty(const QString& sKey) {
+    dirtyKeys.insert(sKey);
+    if(!pCoalesceTimer->isActive())// Not postponed by the changes that follow
+        pCoalesceTimer->start(COALESCE_DELAY);
+}
+
+
+bool
+ConfigStore::setOverride(const QString& sKey, const QVariant& value, QString* pError) {
+    QVariantMap changes;
+    changes[sKey] = value;
+    return setOverrides(changes, pError);
+}
+
+
+// All or nothing, as setValues(): i.e. --sync follower needs its --leader
+bool
+ConfigStore::setOverrides(const QVariantMap& changes, QString* pError) {
+    QVariantMap settings;
+    QString sError = checkChanges(changes, &settings);
+    if(!sError.isEmpty()) {
+        if(pError)
+            *pError = sError;
+        return false;
+    }
+    QStringList changedKeys;
+    for(QVariantMap::const_iterator it=changes.constBegin(); it!=changes.constEnd(); ++it) {
+        overriddenKeys.insert(it.key());
+        dirtyKeys.remove(it.key());
+        if(values.value(it.key()) == settings[it.key()])
+            continue;
+        values[it.key()] = settings[it.key()];
+        changedKeys.append(it.key());
+    }
+    for(int i=0; i<changedKeys.size(); i++)
+        emit changed(changedKeys[i], values[changedKeys[i]]);
+    return true;
+}
+
+
+// The values of the file replace ours, but for the ones that we changed
+// and not yet written, and the overridden ones. A missing value is the
+// default. An invalid one is ignored (with a warning): the previous value
+// is kept if it agrees with the others, else the default is used. If they
+// still disagree, the whole file is ignored.
+void
+ConfigStore::apply(const QVariantMap& fileValues, bool bNotify) {
+    QVariantMap settings = values;
+    for(QHash<QString, Entry>::const_iterator it=schema.constBegin(); it!=schema.constEnd(); ++it) {
+        if(dirtyKeys.contains(it.key()) || overriddenKeys.contains(it.key()))
+            continue;
+        QVariant value = fileValues.value(it.key(), it.value().defaultValue);
+        if(!convert(it.key(), &value)) {
+            qWarning() << "Settings:" << it.key() << "has an invalid type";
+            value = values.value(it.key(), it.value().defaultValue);
+        }
+        settings[it.key()] = value;
+    }
+    // Reverting a key can make another one invalid: again, until nothing
+    // is reverted (every key changes at most twice)
+    QSet<QString> revertedKeys;
+    bool bReverted = true;
+    while(bReverted) {
+        bReverted = false;
+        for(QHash<QString, Entry>::const_iterator it=schema.constBegin(); it!=schema.constEnd(); ++it) {
+            QString sError = validate(it.key(), settings[it.key()], settings);
+            if(sError.isEmpty())
+                continue;
+            QVariant fallback = values.value(it.key(), it.value().defaultValue);
+            if(revertedKeys.contains(it.key()) ||
+               !validate(it.key(), fallback, settings).isEmpty())
+            {
+                fallback = it.value().defaultValue;
+            }
+            if(settings[it.key()] == fallback)
+                continue;
+            qWarning() << "Settings:" << it.key() << sError;
+            settings[it.key()] = fallback;
+            revertedKeys.insert(it.key());
+            bReverted = true;
+        }
+    }
+    QString sError = validateAll(settings);
+    if(!sError.isEmpty()) {// i.e. ThermalWarm above a valid ThermalHot
+        qWarning() << "Settings: file ignored," << sError;
+        if(values.isEmpty()) {// Nothing before: the defaults
+            for(QHash<QString, Entry>::const_iterator it=schema.constBegin(); it!=schema.constEnd(); ++it)
+                settings[it.key()] = it.value().defaultValue;
+        }
+        else
+            settings = values;
+    }
+    QStringList changedKeys;
+    for(QVariantMap::const_iterator it=settings.constBegin(); it!=settings.constEnd(); ++it) {
+        if(values.value(it.key()) != it.value())
+            changedKeys.append(it.key());
+    }
+    values = settings;
+    if(!bNotify)
+        return;
+    for(int i=0; i<changedKeys.size(); i++)
+        emit changed(changedKeys[i], values[changedKeys[i]]);
+}
+
+
+QVariantMap
+ConfigStore::takeChanges() {
+    QVariantMap changes;
+    for(QSet<QString>::const_iterator it=dirtyKeys.constBegin(); it!=dirtyKeys.constEnd(); ++it)
+        changes[*it] = values[*it];
+    dirtyKeys.clear();
+    return changes;
+}
+
+
+void
+ConfigStore::onCoalesceTimeout() {
+    if(dirtyKeys.isEmpty())
+        return;
+    nWritesInFlight++;
+    QMetaObject::invokeMethod(pFile,
+                              "write",
+                              Qt::QueuedConnection,
+                              Q_ARG(QVariantMap, takeChanges()));
+}
+
+
+// Also waits for the writes already queued
+void
+ConfigStore::flush() {
+    pCoalesceTimer->stop();
+    if(dirtyKeys.isEmpty() && (nWritesInFlight == 0))
+        return;
+    nWritesInFlight++;
+    QMetaObject::invokeMethod(pFile,
+                              "write",
+                              Qt::BlockingQueuedConnection,
+                              Q_ARG(QVariantMap, takeChanges()));
+}
+
+
+void
+ConfigStore::onWritten(bool bOk) {
+    nWritesInFlight--;
+    nWrites++;
+    if(!bOk)
+        emit writeFailed(QString("Unable to write the settings to %1").arg(sFile));
+    watchFile();// It could be the first time the file exists
+}
+
+
+// The rename of every save (ours too) replaces the watched file
+void
+ConfigStore::watchFile() {
+    if(!watcher.files().contains(sFile) && QFileInfo::exists(sFile))
+        watcher.addPath(sFile);
+}
+
+
+void
+ConfigStore::onFileChanged() {
+    watchFile();
+    pReloadTimer->start(RELOAD_DELAY);
+}
+
+
+void
+ConfigStore::onReloadTimeout() {
+    QMetaObject::invokeMethod(pFile, "read", Qt::QueuedConnection);
+}
+
+
+// Read before one of our writes: a newer read will follow that write
+void
+ConfigStore::onLoaded(const QVariantMap& fileValues) {
+    if(nWritesInFlight > 0)
+        return;
+    apply(fileValues, true);
+}
@@ -0,0 +1,198 @@
+#ifndef CONFIGSTORE_H
+#define CONFIGSTORE_H
+
+#include <QObject>
+#include <QThread>
+#include <QVariant>
+#include <QHash>
+#include <QSet>
+#include <QFileSystemWatcher>
+#include <functional>
+#include "clock.h"
+
+
+// Limits that the user interface needs too
+#define MIN_INTERVAL        1500  // in ms (depends on the image format: jpeg is HW accelerated !)
+#define MIN_STREAM_INTERVAL 100   // in ms
+#define MAX_STREAM_FPS      30
+#define SYNC_PORT           45454 // Default UDP port of the sync leader
+
+
+// A key of the store, with the type of its values
+template<typename T>
+struct ConfigKey
+{
+    const char* sName;
+};
+
+
+// Every setting of the application. Defaults and valid values are in
+// ConfigStore::declareKeys(); the names are those of the settings file.
+namespace Config
+{
+    const ConfigKey<QString>      BaseDir             = { "BaseDir" };
+    const ConfigKey<QString>      FileName            = { "FileName" };
+    const ConfigKey<int>          Interval            = { "Interval" };               // in ms
+    const ConfigKey<int>          TotalTime           = { "TotalTime" };              // in s (0 = No limit)
+    const ConfigKey<bool>         Continuous          = { "Continuous" };
+    const ConfigKey<bool>         SimulatedCamera     = { "SimulatedCamera" };
+    const ConfigKey<int>          SimulatedStartup    = { "SimulatedStartup" };       // in ms
+    const ConfigKey<int>          SimulatedCrashAfter = { "SimulatedCrashAfter" };    // in frames (0 = never)
+    const ConfigKey<int>          SimulatedHangAfter  = { "SimulatedHangAfter" };     // in frames (0 = never)
+    const ConfigKey<int>          HeartbeatTimeout    = { "HeartbeatTimeout" };       // in ms (0 = from the interval)
+    const ConfigKey<int>          CheckpointFrames    = { "CheckpointFrames" };
+    const ConfigKey<bool>         PackFrames          = { "PackFrames" };
+    const ConfigKey<int>          ChunkSizeMB         = { "ChunkSizeMB" };
+    const ConfigKey<int>          PackerRateKBs       = { "PackerRateKBs" };
+    const ConfigKey<QString>      SysfsRoot           = { "SysfsRoot" };
+    const ConfigKey<double>       ThermalWarm         = { "ThermalWarm" };            // in °C
+    const ConfigKey<double>       ThermalHot          = { "ThermalHot" };             // in °C
+    const ConfigKey<double>       LoadPerCore         = { "LoadPerCore" };
+    const ConfigKey<int>          LatencyBudget       = { "LatencyBudget" };          // in ms
+    const ConfigKey<int>          PreviewFps          = { "PreviewFps" };
+    const ConfigKey<QString>      SyncMode            = { "SyncMode" };               // off, leader or follower
+    const ConfigKey<QString>      SyncLeader          = { "SyncLeader" };             // host:port
+    const ConfigKey<int>          SyncPort            = { "SyncPort" };
+    const ConfigKey<QString>      NodeName            = { "NodeName" };
+    const ConfigKey<QVariantList> OutputProfiles      = { "OutputProfiles" };         // See OutputProfile
+    const ConfigKey<double>       PanValue            = { "panValue" };               // in us
+    const ConfigKey<double>       TiltValue           = { "tiltValue" };              // in us
+    const ConfigKey<QByteArray>   WindowState         = { "mainWindowState" };
+
+    // The shortest Interval: the stream is faster than the stills
+    inline int minInterval(bool bContinuous) {
+        return bContinuous ? MIN_STREAM_INTERVAL : MIN_INTERVAL;
+    }
+}
+
+
+// Reads and writes the settings file for the ConfigStore, in its own
+// thread. QSettings writes a temporary file and renames it over the old
+// one (atomic sync), so after a power cut we find either the old or the
+// new settings, never half of them.
+// The lists (i.e. OutputProfiles) are QSettings arrays of QVariantMaps.
+class ConfigFile : public QObject
+{
+    Q_OBJECT
+
+public:
+    ConfigFile(const QString& sFileName, const QStringList& listKeys);
+
+    QVariantMap readAll();
+
+public slots:
+    void read();
+    void write(const QVariantMap& changes);
+
+signals:
+    void loaded(const QVariantMap& values);
+    void written(bool bOk);
+
+private:
+    QString     sFile;
+    QStringList arrayKeys;
+};
+
+
+// The single place where the settings live.
+// Values are typed (see Config) and validated before being stored: an
+// invalid value is refused, with the reason, and the old one is kept.
+// Every key is validated against the others, so a change that would make
+// another key invalid is refused too: setValues() changes them together.
+// Every change is notified with changed() and written to the file in the
+// background, at most COALESCE_DELAY after the first of a burst of
+// changes and all of them at once. The file is watched: a change made
+// with an editor (i.e. on a headless unit) is validated and applied live.
+// An override (i.e. from the command line) is for this run only: it is
+// never written and it hides the file, until setValue() is used.
+class ConfigStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    // The reason why the value is not valid, empty if it is.
+    // settings are all the values, as they would be with this one.
+    typedef std::function<QString(const QVariant& value, const QVariantMap& settings)> Validator;
+
+    explicit ConfigStore(Clock* pClock,
+                         const QString& sFileName = defaultFileName(),
+                         QObject *parent = nullptr);
+    ~ConfigStore();
+
+    template<typename T>
+    T value(const ConfigKey<T>& key) const {
+        return values.value(QString(key.sName)).template value<T>();
+    }
+    template<typename T>
+    bool setValue(const ConfigKey<T>& key, const T& value, QString* pError = Q_NULLPTR) {
+        return setValue(QString(key.sName), QVariant::fromValue(value), pError);
+    }
+    template<typename T>
+    QString check(const ConfigKey<T>& key, const T& value) const {
+        return check(QString(key.sName), QVariant::fromValue(value));
+    }
+    // By name (i.e. from the command line): converted to the type of the key
+    bool    setValue(const QString& sKey, const QVariant& value, QString* pError = Q_NULLPTR);
+    bool    setValues(const QVariantMap& changes, QString* pError = Q_NULLPTR);
+    bool    setOverride(const QString& sKey, const QVariant& value, QString* pError = Q_NULLPTR);
+    bool    setOverrides(const QVariantMap& changes, QString* pError = Q_NULLPTR);
+    QString check(const QString& sKey, const QVariant& value) const;
+    void    flush();   // Blocks until everything is on disk
+    QString fileName() const { return sFile; }
+    int     writes() const { return nWrites; }
+    static QString defaultFileName();
+
+signals:
+    void changed(const QString& sKey, const QVariant& value);
+    void writeFailed(const QString& sMessage);
+
+private slots:
+    void onCoalesceTimeout();
+    void onWritten(bool bOk);
+    void onFileChanged();
+    void onReloadTimeout();
+    void onLoaded(const QVariantMap& fileValues);
+
+private:
+    struct Entry
+    {
+        QVariant  defaultValue;
+        Validator validator;
+    };
+
+    template<typename T>
+    void declare(const ConfigKey<T>& key, const T& defaultValue, Validator validator = Validator()) {
+        Entry entry;
+        entry.defaultValue = QVariant::fromValue(defaultValue);
+        entry.validator    = validator;
+        schema.insert(QString(key.sName), entry);
+    }
+    void    declareKeys();
+    bool    convert(const QString& sKey, QVariant* pValue) const;
+    QString checkChanges(const QVariantMap& changes, QVariantMap* pSettings) const;
+    QString validate(const QString& sKey, const QVariant& value, const QVariantMap& settings) const;
+    QString validateAll(const QVariantMap& settings) const;
+    void    apply(const QVariantMap& fileValues, bool bNotify);
+    void    markDirty(const QString& sKey);
+    QVariantMap takeChanges();
+    void    watchFile();
+    static Validator atLeast(double min);
+    static Validator between(double min, double max);
+
+private:
+    Clock*                pClock;
+    QString               sFile;
+    QHash<QString, Entry> schema;
+    QVariantMap           values;
+    QSet<QString>         dirtyKeys;       // Changed but not yet sent to the file
+    QSet<QString>         overriddenKeys;  // Not from the file, never written
+    ConfigFile*           pFile;
+    QThread               fileThread;
+    QFileSystemWatcher    watcher;
+    ClockTimer*           pCoalesceTimer;
+    ClockTimer*           pReloadTimer;
+    int                   nWritesInFlight; // Sent to the file but not yet written
+    int                   nWrites;
+};
+
+#endif // CONFIGSTORE_H
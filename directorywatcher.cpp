@@ -0,0 +1,80 @@
+#include "directorywatcher.h"
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <QDebug>
+
+
+DirectoryWatcher::DirectoryWatcher(QObject *parent)
+    : QObject(parent)
+    , inotifyFd(-1)
+    , watchDescriptor(-1)
+    , pNotifier(Q_NULLPTR)
+{
+}
+
+
+DirectoryWatcher::~DirectoryWatcher() {
+    stop();
+}
+
+
+bool
+DirectoryWatcher::watch(const QString& sDirectory, const QString& sPrefix) {
+    stop();
+    sDir        = sDirectory;
+    sNamePrefix = sPrefix;
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd < 0) {
+        qWarning() << "inotify_init1() failed";
+        return false;
+    }
+    // raspistill writes to "name~" and then renames it
+    watchDescriptor = inotify_add_watch(inotifyFd,
+                                        sDir.toLocal8Bit().constData(),
+                                        IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(watchDescriptor < 0) {
+        qWarning() << "Unable to watch" << sDir;
+        stop();
+        return false;
+    }
+    pNotifier = new QSocketNotifier(inotifyFd, QSocketNotifier::Read, this);
+    connect(pNotifier,
+            SIGNAL(activated(int)),
+            this,
+            SLOT(onInotifyEvent()));
+    return true;
+}
+
+
+void
+DirectoryWatcher::stop() {
+    if(pNotifier) {
+        pNotifier->setEnabled(false);
+        pNotifier->deleteLater();
+        pNotifier = Q_NULLPTR;
+    }
+    if(inotifyFd >= 0)
+        ::close(inotifyFd);
+    inotifyFd = -1;
+    watchDescriptor = -1;
+}
+
+
+void
+DirectoryWatcher::onInotifyEvent() {
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    for(;;) {
+        ssize_t len = ::read(inotifyFd, buffer, sizeof(buffer));
+        if(len <= 0)
+            return;
+        for(char* p=buffer; p<buffer+len; ) {
+            const struct inotify_event* pEvent = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + pEvent->len;
+            if(pEvent->len == 0)
+                continue;
+            QString sName = QString::fromLocal8Bit(pEvent->name);
+            if(sName.startsWith(sNamePrefix) && sName.endsWith(QString(".jpg")))
+                emit fileArrived(sDir + QString("/") + sName);
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef DIRECTORYWATCHER_H
+#define DIRECTORYWATCHER_H
+
+#include <QObject>
+#include <QSocketNotifier>
+
+
+// Reports the images written by raspistill in the output folder.
+// QFileSystemWatcher only tells that "something changed" and would force
+// us to list a folder that may contain hundreds of thousands of files:
+// inotify instead gives us the name of every completed file.
+class DirectoryWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DirectoryWatcher(QObject *parent = nullptr);
+    ~DirectoryWatcher();
+
+    bool watch(const QString& sDirectory, const QString& sPrefix);
+    void stop();
+
+signals:
+    void fileArrived(const QString& sFileName);
+
+private slots:
+    void onInotifyEvent();
+
+private:
+    int              inotifyFd;
+    int              watchDescriptor;
+    QSocketNotifier* pNotifier;
+    QString          sDir;
+    QString          sNamePrefix;
+};
+
+#endif // DIRECTORYWATCHER_H
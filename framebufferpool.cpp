@@ -0,0 +1,80 @@
+#include "framebufferpool.h"
+#include <QMutexLocker>
+
+
+FrameBufferPool::FrameBufferPool(int nBuffers, int bufferSize)
+    : pMemory(Q_NULLPTR)
+    , nBuffers(nBuffers)
+    , iBufferSize(bufferSize)
+{
+}
+
+
+FrameBufferPool::~FrameBufferPool() {
+    delete[] pMemory;
+}
+
+
+// On the first acquire(): a session of stills never needs the memory
+void
+FrameBufferPool::allocate() {
+    pMemory = new char[size_t(nBuffers)*size_t(iBufferSize)];
+    buffers.resize(nBuffers);
+    freeList.reserve(nBuffers);
+    for(int i=0; i<nBuffers; i++) {
+        buffers[i].data          = pMemory + size_t(i)*size_t(iBufferSize);
+        buffers[i].capacity      = iBufferSize;
+        buffers[i].offset        = 0;
+        buffers[i].size          = 0;
+        buffers[i].msecTimestamp = 0;
+        buffers[i].frameNum      = -1;
+        freeList.append(&buffers[i]);
+    }
+}
+
+
+FrameBuffer*
+FrameBufferPool::acquire() {
+    QMutexLocker locker(&mutex);
+    if(!pMemory)
+        allocate();
+    if(freeList.isEmpty())
+        return Q_NULLPTR;
+    FrameBuffer* pBuffer = freeList.takeLast();
+    pBuffer->offset   = 0;
+    pBuffer->size     = 0;
+    pBuffer->frameNum = -1;
+    return pBuffer;
+}
+
+
+void
+FrameBufferPool::release(FrameBuffer* pBuffer) {
+    if(!pBuffer)
+        return;
+    QMutexLocker locker(&mutex);
+    freeList.append(pBuffer);
+}
+
+
+// Gives the memory back once every buffer is back: false if some are not
+bool
+FrameBufferPool::trim() {
+    QMutexLocker locker(&mutex);
+    if(!pMemory)
+        return true;
+    if(freeList.size() < nBuffers)
+        return false;
+    freeList.clear();
+    buffers.clear();
+    delete[] pMemory;
+    pMemory = Q_NULLPTR;
+    return true;
+}
+
+
+int
+FrameBufferPool::available() {
+    QMutexLocker locker(&mutex);
+    return pMemory ? freeList.size() : nBuffers;
+}
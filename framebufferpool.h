@@ -0,0 +1,49 @@
+#ifndef FRAMEBUFFERPOOL_H
+#define FRAMEBUFFERPOOL_H
+
+#include <QMutex>
+#include <QVector>
+
+
+// A fixed size block of memory holding (part of) the camera stream.
+// A complete JPEG frame lives in [offset, offset+size) of data.
+struct FrameBuffer
+{
+    char*  data;
+    int    capacity;
+    int    offset;
+    int    size;
+    qint64 msecTimestamp; // When the frame has been completed (ms since Epoch)
+    int    frameNum;
+
+    const char* frame() const { return data+offset; }
+};
+
+
+// All the buffers are allocated at once, by the first acquire(), and
+// recycled: nothing is allocated while the stream is running.
+class FrameBufferPool
+{
+public:
+    FrameBufferPool(int nBuffers, int bufferSize);
+    ~FrameBufferPool();
+
+    FrameBuffer* acquire(); // Returns Q_NULLPTR when the pool is exhausted
+    void release(FrameBuffer* pBuffer);
+    bool trim();            // Frees the memory, until the next acquire()
+    int available();
+    int bufferSize() const { return iBufferSize; }
+
+private:
+    Q_DISABLE_COPY(FrameBufferPool)
+    void allocate();
+
+    QMutex                mutex;
+    QVector<FrameBuffer>  buffers;
+    QVector<FrameBuffer*> freeList;
+    char*                 pMemory;   // Q_NULLPTR until the first acquire()
+    int                   nBuffers;
+    int                   iBufferSize;
+};
+
+#endif // FRAMEBUFFERPOOL_H
@@ -0,0 +1,287 @@
+#include "framemeters.h"
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+#define MAX_FACTOR 16 // The box sums must fit in 16 bits
+
+
+//////////////////////////////////////////////////////////////
+/// Kernels <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+
+// The weights add up to 256: the result never exceeds 255
+void
+MeterKernels::luminanceScalar(const uchar* pRgb32, int nPixels, uchar* pLuma) {
+    const QRgb* pPixels = reinterpret_cast<const QRgb*>(pRgb32);
+    for(int i=0; i<nPixels; i++) {
+        QRgb pixel = pPixels[i];
+        pLuma[i] = uchar((77*qRed(pixel) + 150*qGreen(pixel) + 29*qBlue(pixel)) >> 8);
+    }
+}
+
+
+// Eight pixels per step. RGB32 is B,G,R,A in memory (little endian).
+void
+MeterKernels::luminance(const uchar* pRgb32, int nPixels, uchar* pLuma) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero    = _mm_setzero_si128();
+    const __m128i weights = _mm_setr_epi16(29, 150, 77, 0, 29, 150, 77, 0);
+    for(; i+8 <= nPixels; i+=8) {
+        __m128i y[2];
+        for(int j=0; j<2; j++) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRgb32+4*i+16*j));
+            // Two pixels per register: (B*29+G*150, R*77) pairs to be added
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights);
+            lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+            hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+            lo = _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 3, 2, 0));
+            hi = _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 2, 0));
+            y[j] = _mm_srli_epi32(_mm_unpacklo_epi64(lo, hi), 8);
+        }
+        __m128i y16 = _mm_packs_epi32(y[0], y[1]);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pLuma+i), _mm_packus_epi16(y16, zero));
+    }
+#elif defined(__ARM_NEON)
+    const uint8x8_t wRed   = vdup_n_u8(77);
+    const uint8x8_t wGreen = vdup_n_u8(150);
+    const uint8x8_t wBlue  = vdup_n_u8(29);
+    for(; i+8 <= nPixels; i+=8) {
+        uint8x8x4_t pixels = vld4_u8(pRgb32+4*i);// De-interleaved: B, G, R, A
+        uint16x8_t y = vmull_u8(pixels.val[2], wRed);
+        y = vmlal_u8(y, pixels.val[1], wGreen);
+        y = vmlal_u8(y, pixels.val[0], wBlue);
+        vst1_u8(pLuma+i, vshrn_n_u16(y, 8));
+    }
+#endif
+    luminanceScalar(pRgb32+4*i, nPixels-i, pLuma+i);
+}
+
+
+// A single table would make every pixel wait for the increment of the
+// previous one when they fall in the same bin (which is the rule on a
+// uniform background)
+void
+MeterKernels::histogram(const uchar* pLuma, int nPixels, quint32* pBins) {
+    quint32 partial[4][256];
+    memset(partial, 0, sizeof(partial));
+    int i = 0;
+    for(; i+4 <= nPixels; i+=4) {
+        partial[0][pLuma[i]]++;
+        partial[1][pLuma[i+1]]++;
+        partial[2][pLuma[i+2]]++;
+        partial[3][pLuma[i+3]]++;
+    }
+    for(; i<nPixels; i++)
+        partial[0][pLuma[i]]++;
+    for(int iBin=0; iBin<256; iBin++)
+        pBins[iBin] = partial[0][iBin] + partial[1][iBin] + partial[2][iBin] + partial[3][iBin];
+}
+
+
+double
+MeterKernels::laplacianVarianceScalar(const uchar* pLuma, int width, int height) {
+    if((width < 3) || (height < 3))
+        return 0.0;
+    qint64 sum  = 0;
+    qint64 sum2 = 0;
+    for(int y=1; y<height-1; y++) {
+        const uchar* pUp   = pLuma + (y-1)*width;
+        const uchar* pLine = pLuma + y*width;
+        const uchar* pDown = pLuma + (y+1)*width;
+        for(int x=1; x<width-1; x++) {
+            int laplacian = 4*pLine[x] - pLine[x-1] - pLine[x+1] - pUp[x] - pDown[x];
+            sum  += laplacian;
+            sum2 += laplacian*laplacian;
+        }
+    }
+    double n    = double(width-2)*double(height-2);
+    double mean = double(sum)/n;
+    return double(sum2)/n - mean*mean;
+}
+
+
+// Sixteen pixels per step in 16 bit lanes (|laplacian| <= 1020).
+// The 32 bit lane sums are moved to 64 bits at the end of every line:
+// they cannot overflow within a line narrower than 8000 pixels.
+double
+MeterKernels::laplacianVariance(const uchar* pLuma, int width, int height) {
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    if((width < 3) || (height < 3))
+        return 0.0;
+    qint64 sum  = 0;
+    qint64 sum2 = 0;
+    for(int y=1; y<height-1; y++) {
+        const uchar* pUp   = pLuma + (y-1)*width;
+        const uchar* pLine = pLuma + y*width;
+        const uchar* pDown = pLuma + (y+1)*width;
+        int x = 1;
+        qint32 lineSums[4];
+        qint32 lineSums2[4];
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi16(1);
+        __m128i vSum  = zero;
+        __m128i vSum2 = zero;
+        for(; x+16 <= width-1; x+=16) {
+            __m128i center = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pLine+x));
+            __m128i left   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pLine+x-1));
+            __m128i right  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pLine+x+1));
+            __m128i up     = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pUp+x));
+            __m128i down   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pDown+x));
+            __m128i laplacian[2];
+            laplacian[0] = _mm_sub_epi16(_mm_slli_epi16(_mm_unpacklo_epi8(center, zero), 2),
+                                         _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(left, zero),
+                                                                     _mm_unpacklo_epi8(right, zero)),
+                                                       _mm_add_epi16(_mm_unpacklo_epi8(up, zero),
+                                                                     _mm_unpacklo_epi8(down, zero))));
+            laplacian[1] = _mm_sub_epi16(_mm_slli_epi16(_mm_unpackhi_epi8(center, zero), 2),
+                                         _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(left, zero),
+                                                                     _mm_unpackhi_epi8(right, zero)),
+                                                       _mm_add_epi16(_mm_unpackhi_epi8(up, zero),
+                                                                     _mm_unpackhi_epi8(down, zero))));
+            for(int j=0; j<2; j++) {
+                vSum  = _mm_add_epi32(vSum,  _mm_madd_epi16(laplacian[j], ones));
+                vSum2 = _mm_add_epi32(vSum2, _mm_madd_epi16(laplacian[j], laplacian[j]));
+            }
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lineSums),  vSum);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lineSums2), vSum2);
+#else
+        int32x4_t vSum  = vdupq_n_s32(0);
+        int32x4_t vSum2 = vdupq_n_s32(0);
+        for(; x+16 <= width-1; x+=16) {
+            uint8x16_t center = vld1q_u8(pLine+x);
+            uint8x16_t left   = vld1q_u8(pLine+x-1);
+            uint8x16_t right  = vld1q_u8(pLine+x+1);
+            uint8x16_t up     = vld1q_u8(pUp+x);
+            uint8x16_t down   = vld1q_u8(pDown+x);
+            int16x8_t laplacian[2];
+            // Modular 16 bit arithmetic: the difference is right as signed
+            laplacian[0] = vreinterpretq_s16_u16(
+                               vsubq_u16(vshll_n_u8(vget_low_u8(center), 2),
+                                         vaddq_u16(vaddl_u8(vget_low_u8(left), vget_low_u8(right)),
+                                                   vaddl_u8(vget_low_u8(up),   vget_low_u8(down)))));
+            laplacian[1] = vreinterpretq_s16_u16(
+                               vsubq_u16(vshll_n_u8(vget_high_u8(center), 2),
+                                         vaddq_u16(vaddl_u8(vget_high_u8(left), vget_high_u8(right)),
+                                                   vaddl_u8(vget_high_u8(up),   vget_high_u8(down)))));
+            for(int j=0; j<2; j++) {
+                vSum  = vpadalq_s16(vSum, laplacian[j]);
+                vSum2 = vmlal_s16(vSum2, vget_low_s16(laplacian[j]),  vget_low_s16(laplacian[j]));
+                vSum2 = vmlal_s16(vSum2, vget_high_s16(laplacian[j]), vget_high_s16(laplacian[j]));
+            }
+        }
+        vst1q_s32(lineSums,  vSum);
+        vst1q_s32(lineSums2, vSum2);
+#endif
+        for(int j=0; j<4; j++) {
+            sum  += lineSums[j];
+            sum2 += lineSums2[j];
+        }
+        for(; x<width-1; x++) {
+            int laplacian = 4*pLine[x] - pLine[x-1] - pLine[x+1] - pUp[x] - pDown[x];
+            sum  += laplacian;
+            sum2 += laplacian*laplacian;
+        }
+    }
+    double n    = double(width-2)*double(height-2);
+    double mean = double(sum)/n;
+    return double(sum2)/n - mean*mean;
+#else
+    return laplacianVarianceScalar(pLuma, width, height);
+#endif
+}
+
+
+//////////////////////////////////////////////////////////////
+/// Meter <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+FrameMeter::FrameMeter(int maxWidth, double roiFraction)
+    : maxLumaWidth(qMax(3, maxWidth))
+    , roiSide(qBound(0.1, roiFraction, 1.0))
+    , lumaWidth(0)
+    , lumaHeight(0)
+{
+}
+
+
+bool
+FrameMeter::measure(const QImage& image, FrameMeters* pMeters) {
+    if(image.isNull())
+        return false;
+    // The decoded JPEGs are RGB32: anything else costs a conversion
+    QImage converted;
+    const QImage* pImage = &image;
+    if((image.format() != QImage::Format_RGB32) &&
+       (image.format() != QImage::Format_ARGB32) &&
+       (image.format() != QImage::Format_ARGB32_Premultiplied))
+    {
+        converted = image.convertToFormat(QImage::Format_RGB32);
+        pImage = &converted;
+    }
+    QSize roiSize(int(pImage->width()*roiSide), int(pImage->height()*roiSide));
+    QRect roi(QPoint((pImage->width()-roiSize.width())/2,
+                     (pImage->height()-roiSize.height())/2),
+              roiSize);
+    int factor = qBound(1, (roi.width()+maxLumaWidth-1)/maxLumaWidth, MAX_FACTOR);
+    if((roi.width()/factor < 3) || (roi.height()/factor < 3))
+        return false;
+    reduce(*pImage, roi, factor);
+
+    int nPixels = lumaWidth*lumaHeight;
+    MeterKernels::histogram(luma.constData(), nPixels, pMeters->histogram);
+    quint32 nClipped = 0;
+    for(int iBin=CLIP_LEVEL; iBin<256; iBin++)
+        nClipped += pMeters->histogram[iBin];
+    pMeters->nPixels   = nPixels;
+    pMeters->clipped   = 100.0*nClipped/nPixels;
+    pMeters->sharpness = MeterKernels::laplacianVariance(luma.constData(), lumaWidth, lumaHeight);
+    return true;
+}
+
+
+// Luminance of the roi, averaged over factor x factor blocks
+void
+FrameMeter::reduce(const QImage& image, const QRect& roi, int factor) {
+    lumaWidth  = roi.width()/factor;
+    lumaHeight = roi.height()/factor;
+    int lineWidth = lumaWidth*factor;
+    // Within the capacity after the first frame: no allocation
+    luma.resize(lumaWidth*lumaHeight);
+    lineLuma.resize(lineWidth);
+    lineSum.resize(lineWidth);
+    int area = factor*factor;
+    for(int y=0; y<lumaHeight; y++) {
+        uchar* pOut = luma.data() + y*lumaWidth;
+        if(factor == 1) {
+            MeterKernels::luminance(image.constScanLine(roi.top()+y) + 4*roi.left(),
+                                    lumaWidth,
+                                    pOut);
+            continue;
+        }
+        lineSum.fill(0);
+        for(int k=0; k<factor; k++) {
+            MeterKernels::luminance(image.constScanLine(roi.top()+y*factor+k) + 4*roi.left(),
+                                    lineWidth,
+                                    lineLuma.data());
+            quint16*     pSum  = lineSum.data();
+            const uchar* pLine = lineLuma.constData();
+            for(int x=0; x<lineWidth; x++)
+                pSum[x] += pLine[x];
+        }
+        const quint16* pSum = lineSum.constData();
+        for(int x=0; x<lumaWidth; x++) {
+            int blockSum = 0;
+            for(int k=0; k<factor; k++)
+                blockSum += pSum[x*factor+k];
+            pOut[x] = uchar(blockSum/area);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef FRAMEMETERS_H
+#define FRAMEMETERS_H
+
+#include <QImage>
+#include <QVector>
+#include <QMetaType>
+
+
+#define CLIP_LEVEL 250 // Luminance counted as a clipped highlight
+
+
+// What the framing assist shows while aiming the camera
+struct FrameMeters
+{
+    double  sharpness;      // Variance of the Laplacian of the luminance
+    double  clipped;        // Percentage of pixels at or above CLIP_LEVEL
+    quint32 histogram[256]; // Luminance of the measured area
+    int     nPixels;
+};
+Q_DECLARE_METATYPE(FrameMeters)
+
+
+// The per pixel loops. The default ones use SSE2 or NEON when the
+// compiler targets them, the Scalar ones are the reference (and the
+// fallback). The luminance planes are 8 bits, width bytes per line.
+namespace MeterKernels
+{
+    // RGB32 pixels to luminance (BT.601 weights, 8 bit fixed point)
+    void luminance(const uchar* pRgb32, int nPixels, uchar* pLuma);
+    void luminanceScalar(const uchar* pRgb32, int nPixels, uchar* pLuma);
+    // Four partial histograms, merged at the end: no vector unit helps here
+    void histogram(const uchar* pLuma, int nPixels, quint32* pBins);
+    // 4-neighbour Laplacian, over the inner (width-2)x(height-2) pixels
+    double laplacianVariance(const uchar* pLuma, int width, int height);
+    double laplacianVarianceScalar(const uchar* pLuma, int width, int height);
+}
+
+
+// Measures the central part of the preview frames, reduced by an integer
+// box filter to at most maxWidth pixels across, so that a frame costs a
+// small fraction of the preview interval even on the Raspberry.
+// The working buffers are allocated on the first frame and then reused.
+class FrameMeter
+{
+public:
+    explicit FrameMeter(int maxWidth = 256, double roiFraction = 0.5);
+
+    bool measure(const QImage& image, FrameMeters* pMeters);
+    QSize measuredSize() const { return QSize(lumaWidth, lumaHeight); }
+
+protected:
+    void reduce(const QImage& image, const QRect& roi, int factor);
+
+private:
+    int             maxLumaWidth;
+    double          roiSide;       // Fraction of the frame side
+    QVector<uchar>  luma;          // The reduced area
+    QVector<uchar>  lineLuma;      // One full resolution line of the area
+    QVector<quint16> lineSum;      // factor lines, added up
+    int             lumaWidth;
+    int             lumaHeight;
+};
+
+#endif // FRAMEMETERS_H
@@ -0,0 +1,162 @@
+#include "framepacker.h"
+#include <QThread>
+#include <QFile>
+#include <QDebug>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+
+#define MAX_BURST          (256*1024) // Bytes we may write without waiting
+#define MIN_RATE           (64*1024)  // bytes per second
+#define IOPRIO_CLASS_IDLE  3
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+
+
+FramePacker::FramePacker(QObject *parent)
+    : QObject(parent)
+    , chunkSize(0)
+    , rate(MIN_RATE)
+    , tokens(MAX_BURST)
+    , bEnabled(false)
+    , bPaused(false)
+{
+    refillTime.start();
+}
+
+
+// The disk is given to us only when nobody else wants it
+void
+FramePacker::lowerPriority() {
+    QThread::currentThread()->setPriority(QThread::LowestPriority);
+#ifdef SYS_ioprio_set
+    if(syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0)
+        qWarning() << "Unable to set the packer I/O priority";
+#endif
+}
+
+
+void
+FramePacker::startSession(const QString& sBaseDir,
+                          const QString& sFileName,
+                          bool bPack,
+                          qint64 chunkBytes,
+                          int bytesPerSecond)
+{
+    flush();
+    deferredFrames.clear();// Still paused: they stay loose
+    this->sBaseDir = sBaseDir;
+    sOutFileName   = sFileName;
+    bEnabled       = bPack;
+    chunkSize      = chunkBytes;
+    rate           = qMax(qint64(bytesPerSecond), qint64(MIN_RATE));
+}
+
+
+void
+FramePacker::addFrame(int frameNum, const QString& sFileName) {
+    if(!bEnabled || sFileName.isEmpty())// Not packing, or the raw frame has not been saved
+        return;
+    if(bPaused || !deferredFrames.isEmpty()) {
+        deferredFrames.enqueue(qMakePair(frameNum, sFileName));
+        return;
+    }
+    packFrame(frameNum, sFileName);
+}
+
+
+void
+FramePacker::setPaused(bool bPause) {
+    bPaused = bPause;
+    if(!bPaused && !deferredFrames.isEmpty())
+        QMetaObject::invokeMethod(this, "packDeferred", Qt::QueuedConnection);
+}
+
+
+// One frame at a time, so that a new pause is honored at once
+void
+FramePacker::packDeferred() {
+    if(bPaused || deferredFrames.isEmpty())
+        return;
+    QPair<int, QString> frame = deferredFrames.dequeue();
+    packFrame(frame.first, frame.second);
+    if(!deferredFrames.isEmpty())
+        QMetaObject::invokeMethod(this, "packDeferred", Qt::QueuedConnection);
+}
+
+
+void
+FramePacker::packFrame(int frameNum, const QString& sFileName) {
+    QFile file(sFileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        emit packerError(QString("Unable to read %1").arg(sFileName));
+        return;
+    }
+    QByteArray jpeg = file.readAll();
+    file.close();
+
+    // Frames out of order (i.e. a resumed session) start a new chunk
+    if(writer.isOpen() && (frameNum <= writer.lastFrame()))
+        commitChunk();
+    if(!writer.isOpen()) {
+        sChunkFile = QString("%1/%2_chunk_%3.isq")
+                             .arg(sBaseDir)
+                             .arg(sOutFileName)
+                             .arg(frameNum, 6, 10, QChar('0'));
+        if(!writer.open(sChunkFile, frameNum)) {
+            emit packerError(QString("Unable to create %1").arg(sChunkFile));
+            return;
+        }
+    }
+    throttle(jpeg.size());
+    if(!writer.append(frameNum, jpeg.constData(), jpeg.size())) {
+        emit packerError(QString("Unable to pack frame %1").arg(frameNum));
+        return;
+    }
+    packedFiles.append(sFileName);
+    if(writer.size() >= chunkSize)
+        commitChunk();
+}
+
+
+void
+FramePacker::flush() {
+    while(!bPaused && !deferredFrames.isEmpty()) {
+        QPair<int, QString> frame = deferredFrames.dequeue();
+        packFrame(frame.first, frame.second);
+    }
+    if(writer.isOpen())
+        commitChunk();
+}
+
+
+// The loose files are removed only when they are safe in the chunk
+bool
+FramePacker::commitChunk() {
+    int nFrames = packedFiles.size();
+    if(!writer.commit()) {
+        emit packerError(QString("Unable to write %1").arg(sChunkFile));
+        packedFiles.clear();// Still on disk as they were
+        return false;
+    }
+    for(int i=0; i<packedFiles.size(); i++)
+        QFile::remove(packedFiles[i]);
+    packedFiles.clear();
+    emit chunkWritten(sChunkFile, nFrames);
+    return true;
+}
+
+
+// Token bucket: bursts of at most MAX_BURST bytes, then rate bytes/s
+void
+FramePacker::throttle(qint64 nBytes) {
+    tokens += double(refillTime.restart())*rate/1000.0;
+    if(tokens > MAX_BURST)
+        tokens = MAX_BURST;
+    tokens -= nBytes;
+    if(tokens < 0.0) {
+        QThread::msleep(ulong(-tokens*1000.0/rate));
+        tokens = 0.0;
+        refillTime.restart();
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef FRAMEPACKER_H
+#define FRAMEPACKER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QQueue>
+#include <QPair>
+#include "chunkarchive.h"
+
+
+// Rolls the frames of a session into chunks of about chunkBytes each,
+// named <name>_chunk_<first frame>.isq, and removes the loose files once
+// their chunk has been committed.
+// It runs in its own thread at idle I/O priority and never writes faster
+// than bytesPerSecond, so that the camera always finds the SD card free.
+// While paused (see ResourceGovernor) the frames are only queued: they
+// are packed, in order, once resumed.
+class FramePacker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FramePacker(QObject *parent = nullptr);
+
+public slots:
+    void lowerPriority(); // To be called from the packer thread
+    // Unless bPack, the frames of the session stay loose
+    void startSession(const QString& sBaseDir,
+                      const QString& sFileName,
+                      bool bPack,
+                      qint64 chunkBytes,
+                      int bytesPerSecond);
+    void addFrame(int frameNum, const QString& sFileName);
+    void setPaused(bool bPause);
+    void flush(); // Packs the queued frames too, unless paused
+
+private slots:
+    void packDeferred();
+
+signals:
+    void chunkWritten(const QString& sChunkFile, int nFrames);
+    void packerError(const QString& sMessage);
+
+protected:
+    void packFrame(int frameNum, const QString& sFileName);
+    void throttle(qint64 nBytes);
+    bool commitChunk();
+
+private:
+    ChunkWriter   writer;
+    QStringList   packedFiles; // Waiting for the chunk commit
+    QString       sBaseDir;
+    QString       sOutFileName;
+    QString       sChunkFile;  // The one being written
+    qint64        chunkSize;
+    qint64        rate;        // bytes per second
+    double        tokens;      // bytes we can write right now
+    QElapsedTimer refillTime;
+    QQueue<QPair<int, QString>> deferredFrames;
+    bool          bEnabled;    // For this session
+    bool          bPaused;
+};
+
+#endif // FRAMEPACKER_H
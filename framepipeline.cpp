@@ -0,0 +1,232 @@
+#include "framepipeline.h"
+#include <QtConcurrent>
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QImageWriter>
+#include <QMutexLocker>
+
+
+static bool
+encodeProfile(const QImage& image,
+              const OutputProfile& profile,
+              const FrameMetadata& metadata,
+              const QString& sFileName)
+{
+    QImage view = image;
+    if(!profile.roi.isNull()) {
+        QRect roi = profile.roi.intersected(image.rect());
+        if(roi.isEmpty())
+            return false;
+        // A view on the shared decoded image: no pixel is copied
+        view = QImage(image.constBits()
+                      + roi.y()*image.bytesPerLine()
+                      + roi.x()*(image.depth()/8),
+                      roi.width(),
+                      roi.height(),
+                      image.bytesPerLine(),
+                      image.format());
+    }
+    if(!profile.size.isEmpty())
+        view = view.scaled(profile.size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    QByteArray jpeg;
+    QBuffer buffer(&jpeg);
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter writer(&buffer, "jpg");
+    writer.setQuality(profile.quality);
+    if(!writer.write(view))
+        return false;
+    return JpegMetadata::write(sFileName, jpeg.constData(), jpeg.size(), metadata);
+}
+
+
+FramePipeline::FramePipeline(FrameBufferPool* pPool, QObject *parent)
+    : QObject(parent)
+    , pPool(pPool)
+    , bEncodingPaused(false)
+{
+}
+
+
+void
+FramePipeline::setSession(const QString& sBaseDir,
+                          const QString& sFileName,
+                          const QVector<OutputProfile>& profiles)
+{
+    QMutexLocker locker(&sessionMutex);
+    this->sBaseDir = sBaseDir;
+    sOutFileName   = sFileName;
+    outputProfiles = profiles;
+    QDir dir(sBaseDir);
+    for(int i=0; i<outputProfiles.size(); i++) {
+        if(!outputProfiles[i].isPassThrough())
+            dir.mkpath(outputProfiles[i].sName);
+    }
+}
+
+
+QString
+FramePipeline::outputName(const OutputProfile& profile, int frameNum) {
+    QMutexLocker locker(&sessionMutex);
+    if(profile.isPassThrough())
+        return QString("%1/%2_%3.jpg")
+                .arg(sBaseDir)
+                .arg(sOutFileName)
+                .arg(frameNum, 6, 10, QChar('0'));
+    return QString("%1/%2/%3_%4.jpg")
+            .arg(sBaseDir)
+            .arg(profile.sName)
+            .arg(sOutFileName)
+            .arg(frameNum, 6, 10, QChar('0'));
+}
+
+
+QString
+FramePipeline::rawName(int frameNum) {
+    return outputName(OutputProfile(), frameNum);
+}
+
+
+QVector<OutputProfile>
+FramePipeline::sessionProfiles() {
+    QMutexLocker locker(&sessionMutex);
+    return outputProfiles;
+}
+
+
+// From the video port: the raw frame is saved only if there is a
+// pass-through profile
+void
+FramePipeline::processBuffer(FrameBuffer* pFrame, const FrameMetadata& metadata) {
+    QVector<OutputProfile> profiles = sessionProfiles();
+    QString sRawFile;
+    for(int i=0; i<profiles.size(); i++) {
+        if(profiles[i].isPassThrough()) {
+            sRawFile = rawName(metadata.frameNum);
+            break;
+        }
+    }
+    if(!sRawFile.isEmpty() &&
+       !JpegMetadata::write(sRawFile, pFrame->frame(), pFrame->size, metadata))
+    {
+        emit pipelineError(QString("Unable to write %1").arg(sRawFile));
+        sRawFile.clear();
+    }
+    encodeProfiles(metadata, pFrame->frame(), pFrame->size);
+    pPool->release(pFrame);
+    emit frameProcessed(metadata.frameNum, sRawFile);
+}
+
+
+// From raspistill: the file is moved from the staging folder to its final
+// name while the metadata are spliced in. The image data are copied by
+// the kernel and read back only if some profile has to be encoded.
+void
+FramePipeline::processFile(const FrameMetadata& metadata, const QString& sFileName) {
+    QString sRawFile = rawName(metadata.frameNum);
+    if(JpegMetadata::copy(sFileName, sRawFile, metadata)) {
+        QFile::remove(sFileName);
+    }
+    else {
+        emit pipelineError(QString("Unable to write %1").arg(sRawFile));
+        sRawFile = sFileName;
+    }
+    QVector<OutputProfile> profiles = sessionProfiles();
+    bool bEncode = false;
+    for(int i=0; i<profiles.size(); i++)
+        bEncode |= !profiles[i].isPassThrough();
+    if(bEncode && (bEncodingPaused || !deferredFrames.isEmpty())) {
+        DeferredFrame frame = { metadata, sRawFile };
+        deferredFrames.enqueue(frame);// Behind the ones still waiting
+        return;
+    }
+    if(bEncode)
+        encodeFile(metadata, sRawFile);
+    emit frameProcessed(metadata.frameNum, sRawFile);
+}
+
+
+void
+FramePipeline::encodeFile(const FrameMetadata& metadata, const QString& sFileName) {
+    QFile file(sFileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        emit pipelineError(QString("Unable to read %1").arg(sFileName));
+        return;
+    }
+    QByteArray jpeg = file.readAll();
+    file.close();
+    encodeProfiles(metadata, jpeg.constData(), jpeg.size());
+}
+
+
+void
+FramePipeline::setEncoderThreads(int nThreads) {
+    encoderPool.setMaxThreadCount(qMax(1, nThreads));
+}
+
+
+void
+FramePipeline::setEncodingPaused(bool bPaused) {
+    bEncodingPaused = bPaused;
+    if(!bEncodingPaused && !deferredFrames.isEmpty())
+        QMetaObject::invokeMethod(this, "encodeDeferred", Qt::QueuedConnection);
+}
+
+
+// One frame at a time, so that a new pause is honored at once
+void
+FramePipeline::encodeDeferred() {
+    if(bEncodingPaused || deferredFrames.isEmpty())
+        return;
+    DeferredFrame frame = deferredFrames.dequeue();
+    encodeFile(frame.metadata, frame.sFileName);
+    emit frameProcessed(frame.metadata.frameNum, frame.sFileName);
+    if(!deferredFrames.isEmpty())
+        QMetaObject::invokeMethod(this, "encodeDeferred", Qt::QueuedConnection);
+}
+
+
+void
+FramePipeline::flush() {
+    while(!deferredFrames.isEmpty()) {
+        DeferredFrame frame = deferredFrames.dequeue();
+        encodeFile(frame.metadata, frame.sFileName);
+        emit frameProcessed(frame.metadata.frameNum, frame.sFileName);
+    }
+}
+
+
+void
+FramePipeline::encodeProfiles(const FrameMetadata& metadata, const char* pData, int size) {
+    QVector<OutputProfile> profiles = sessionProfiles();
+    QVector<int> toEncode;
+    for(int i=0; i<profiles.size(); i++) {
+        if(!profiles[i].isPassThrough())
+            toEncode.append(i);
+    }
+    if(toEncode.isEmpty())
+        return;
+    // Decoded just once for all the profiles
+    QImage image;
+    if(!image.loadFromData(reinterpret_cast<const uchar*>(pData), size, "JPG")) {
+        emit pipelineError(QString("Unable to decode frame %1").arg(metadata.frameNum));
+        return;
+    }
+    QVector<QFuture<bool>> results;
+    for(int i=0; i<toEncode.size(); i++) {
+        const OutputProfile& profile = profiles[toEncode[i]];
+        results.append(QtConcurrent::run(&encoderPool,
+                                         encodeProfile,
+                                         image,
+                                         profile,
+                                         metadata,
+                                         outputName(profile, metadata.frameNum)));
+    }
+    for(int i=0; i<results.size(); i++) {
+        if(!results[i].result())
+            emit pipelineError(QString("Unable to write the \"%1\" profile of frame %2")
+                               .arg(profiles[toEncode[i]].sName)
+                               .arg(metadata.frameNum));
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <QObject>
+#include <QMutex>
+#include <QQueue>
+#include <QThreadPool>
+#include "framebufferpool.h"
+#include "outputprofile.h"
+#include "jpegmetadata.h"
+
+
+// Produces all the output profiles of a frame in a single pass.
+// It lives in its own thread: every frame is decoded once and the
+// crops are views on the decoded image, so that the only per profile
+// work (scaling and JPEG encoding) can run in parallel.
+// The frame as delivered by the camera is saved as <name>_<frame>.jpg
+// with its FrameMetadata spliced in: <name> is the one of the session
+// (see MainWindow::sessionFileName()).
+// The encoder threads can be reduced and, for the stills, the profiles
+// can be paused (see ResourceGovernor): the paused frames are encoded,
+// in order, when resumed and are reported by frameProcessed() only then.
+class FramePipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FramePipeline(FrameBufferPool* pPool, QObject *parent = nullptr);
+
+    void setSession(const QString& sBaseDir,
+                    const QString& sFileName,
+                    const QVector<OutputProfile>& profiles);
+
+public slots:
+    void processBuffer(FrameBuffer* pFrame, const FrameMetadata& metadata);
+    void processFile(const FrameMetadata& metadata, const QString& sFileName);
+    void setEncoderThreads(int nThreads);
+    void setEncodingPaused(bool bPaused);
+    void flush(); // Encodes the deferred frames, paused or not
+
+private slots:
+    void encodeDeferred();
+
+signals:
+    // sFileName is the frame as delivered by the camera (empty if not saved)
+    void frameProcessed(int frameNum, const QString& sFileName);
+    void pipelineError(const QString& sMessage);
+
+protected:
+    void encodeProfiles(const FrameMetadata& metadata, const char* pData, int size);
+    void encodeFile(const FrameMetadata& metadata, const QString& sFileName);
+    QVector<OutputProfile> sessionProfiles();
+    QString outputName(const OutputProfile& profile, int frameNum);
+    QString rawName(int frameNum);
+
+private:
+    struct DeferredFrame {
+        FrameMetadata metadata;
+        QString       sFileName;
+    };
+    FrameBufferPool*       pPool;
+    QThreadPool            encoderPool;
+    QMutex                 sessionMutex;
+    QString                sBaseDir;
+    QString                sOutFileName;
+    QVector<OutputProfile> outputProfiles;
+    QQueue<DeferredFrame>  deferredFrames;
+    bool                   bEncodingPaused;
+};
+
+#endif // FRAMEPIPELINE_H
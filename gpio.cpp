@@ -0,0 +1,178 @@
+#include "gpio.h"
+#include "clock.h"
+#include "pigpiod_if2.h"// The library for using GPIO pins on Raspberry
+
+
+Gpio::~Gpio() {
+}
+
+
+//////////////////////////////////////////////////////////////
+/// pigpiod <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+PigpioGpio::PigpioGpio(const QString& sHost, const QString& sPort)
+    : sHostName(sHost)
+    , sHostPort(sPort)
+    , hostHandle(-1)
+{
+}
+
+
+PigpioGpio::~PigpioGpio() {
+    stop();
+}
+
+
+int
+PigpioGpio::start() {
+    hostHandle = pigpio_start(sHostName.toLocal8Bit().data(),
+                              sHostPort.toLocal8Bit().data());
+    return hostHandle;
+}
+
+
+void
+PigpioGpio::stop() {
+    if(hostHandle >= 0)
+        pigpio_stop(hostHandle);
+    hostHandle = -1;
+}
+
+
+int
+PigpioGpio::setMode(unsigned pin, unsigned mode) {
+    return set_mode(hostHandle, pin, mode);
+}
+
+
+int
+PigpioGpio::setPullUpDown(unsigned pin, unsigned pud) {
+    return set_pull_up_down(hostHandle, pin, pud);
+}
+
+
+int
+PigpioGpio::write(unsigned pin, unsigned level) {
+    return gpio_write(hostHandle, pin, level);
+}
+
+
+int
+PigpioGpio::setPwmFrequency(unsigned pin, unsigned frequency) {
+    return set_PWM_frequency(hostHandle, pin, frequency);
+}
+
+
+int
+PigpioGpio::setServoPulseWidth(unsigned pin, unsigned pulseWidth) {
+    return set_servo_pulsewidth(hostHandle, pin, pulseWidth);
+}
+
+
+//////////////////////////////////////////////////////////////
+/// Simulated <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+SimulatedGpio::SimulatedGpio(Clock* pClock)
+    : pClock(pClock)
+    , bStarted(false)
+    , nCommands(0)
+{
+}
+
+
+int
+SimulatedGpio::start() {
+    bStarted = true;
+    return 0;
+}
+
+
+void
+SimulatedGpio::stop() {
+    bStarted = false;
+}
+
+
+int
+SimulatedGpio::setMode(unsigned pin, unsigned mode) {
+    Q_UNUSED(pin)
+    Q_UNUSED(mode)
+    nCommands++;
+    return bStarted ? 0 : PI_NOT_INITIALISED;
+}
+
+
+int
+SimulatedGpio::setPullUpDown(unsigned pin, unsigned pud) {
+    Q_UNUSED(pin)
+    Q_UNUSED(pud)
+    nCommands++;
+    return bStarted ? 0 : PI_NOT_INITIALISED;
+}
+
+
+int
+SimulatedGpio::write(unsigned pin, unsigned level) {
+    nCommands++;
+    if(!bStarted)
+        return PI_NOT_INITIALISED;
+    qint64 msecNow = pClock->msecNow();
+    if(!pins.contains(pin)) {
+        PinState state = { 0, msecNow, 0, 0 };
+        pins.insert(pin, state);
+    }
+    PinState& state = pins[pin];
+    level = level ? 1 : 0;
+    if(level == state.level)
+        return 0;
+    if(state.level)
+        state.msecHigh += msecNow - state.msecLastChange;
+    else
+        state.nRisingEdges++;
+    state.level          = level;
+    state.msecLastChange = msecNow;
+    return 0;
+}
+
+
+int
+SimulatedGpio::setPwmFrequency(unsigned pin, unsigned frequency) {
+    Q_UNUSED(pin)
+    Q_UNUSED(frequency)
+    nCommands++;
+    return bStarted ? 0 : PI_NOT_INITIALISED;
+}
+
+
+int
+SimulatedGpio::setServoPulseWidth(unsigned pin, unsigned pulseWidth) {
+    nCommands++;
+    if(!bStarted)
+        return PI_NOT_INITIALISED;
+    pulseWidths.insert(pin, pulseWidth);
+    return 0;
+}
+
+
+unsigned
+SimulatedGpio::level(unsigned pin) const {
+    return pins.contains(pin) ? pins[pin].level : 0;
+}
+
+
+int
+SimulatedGpio::risingEdges(unsigned pin) const {
+    return pins.contains(pin) ? pins[pin].nRisingEdges : 0;
+}
+
+
+qint64
+SimulatedGpio::msecHigh(unsigned pin) const {
+    if(!pins.contains(pin))
+        return 0;
+    const PinState& state = pins[pin];
+    qint64 msecTotal = state.msecHigh;
+    if(state.level)
+        msecTotal += pClock->msecNow() - state.msecLastChange;
+    return msecTotal;
+}
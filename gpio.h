@@ -0,0 +1,90 @@
+#ifndef GPIO_H
+#define GPIO_H
+
+#include <QMap>
+#include <QVector>
+#include <QString>
+
+class Clock;
+
+
+// The pigpiod calls we use, behind an interface so that the lamp and the
+// servos can be driven without a Raspberry (see SimulatedGpio).
+// Return values are those of pigpiod_if2: >= 0 Ok, < 0 error code.
+class Gpio
+{
+public:
+    virtual ~Gpio();
+
+    virtual int  start() = 0;
+    virtual void stop() = 0;
+    virtual bool isConnected() const = 0;
+    virtual int  setMode(unsigned pin, unsigned mode) = 0;
+    virtual int  setPullUpDown(unsigned pin, unsigned pud) = 0;
+    virtual int  write(unsigned pin, unsigned level) = 0;
+    virtual int  setPwmFrequency(unsigned pin, unsigned frequency) = 0;
+    virtual int  setServoPulseWidth(unsigned pin, unsigned pulseWidth) = 0;
+};
+
+
+// The pigpio daemon
+class PigpioGpio : public Gpio
+{
+public:
+    PigpioGpio(const QString& sHost = QString("localhost"),
+               const QString& sPort = QString("8888"));
+    ~PigpioGpio();
+
+    int  start() Q_DECL_OVERRIDE;
+    void stop() Q_DECL_OVERRIDE;
+    bool isConnected() const Q_DECL_OVERRIDE { return hostHandle >= 0; }
+    int  setMode(unsigned pin, unsigned mode) Q_DECL_OVERRIDE;
+    int  setPullUpDown(unsigned pin, unsigned pud) Q_DECL_OVERRIDE;
+    int  write(unsigned pin, unsigned level) Q_DECL_OVERRIDE;
+    int  setPwmFrequency(unsigned pin, unsigned frequency) Q_DECL_OVERRIDE;
+    int  setServoPulseWidth(unsigned pin, unsigned pulseWidth) Q_DECL_OVERRIDE;
+
+private:
+    QString sHostName;
+    QString sHostPort;
+    int     hostHandle;
+};
+
+
+// Keeps the level history of every output, timed by a Clock,
+// so that i.e. the lamp duty cycle can be checked.
+class SimulatedGpio : public Gpio
+{
+public:
+    explicit SimulatedGpio(Clock* pClock);
+
+    int  start() Q_DECL_OVERRIDE;
+    void stop() Q_DECL_OVERRIDE;
+    bool isConnected() const Q_DECL_OVERRIDE { return bStarted; }
+    int  setMode(unsigned pin, unsigned mode) Q_DECL_OVERRIDE;
+    int  setPullUpDown(unsigned pin, unsigned pud) Q_DECL_OVERRIDE;
+    int  write(unsigned pin, unsigned level) Q_DECL_OVERRIDE;
+    int  setPwmFrequency(unsigned pin, unsigned frequency) Q_DECL_OVERRIDE;
+    int  setServoPulseWidth(unsigned pin, unsigned pulseWidth) Q_DECL_OVERRIDE;
+
+    unsigned level(unsigned pin) const;
+    int      commands() const { return nCommands; }
+    int      risingEdges(unsigned pin) const;
+    qint64   msecHigh(unsigned pin) const;   // Total time spent high up to now
+    unsigned pulseWidth(unsigned pin) const { return pulseWidths.value(pin, 0); }
+
+private:
+    struct PinState {
+        unsigned level;
+        qint64   msecLastChange;
+        qint64   msecHigh;
+        int      nRisingEdges;
+    };
+    Clock*                   pClock;
+    bool                     bStarted;
+    int                      nCommands;
+    QMap<unsigned, PinState> pins;
+    QMap<unsigned, unsigned> pulseWidths;
+};
+
+#endif // GPIO_H
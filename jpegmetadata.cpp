@@ -0,0 +1,304 @@
+#include "jpegmetadata.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QVector>
+#include <QtEndian>
+#include <QDebug>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+
+#define HEADER_PEEK    (256*1024) // The APP0/APP1 of raspistill (with thumbnail) fit here
+#define COPY_BLOCK     (256*1024)
+#define MAX_SEGMENT    65533      // APP1 payload limit
+#define XMP_NAMESPACE  "http://github.com/salvato/ImageSequence/1.0/"
+
+#define EXIF_ASCII     2
+#define EXIF_LONG      4
+
+
+// One TIFF directory with its out of line values
+class TiffIfd
+{
+public:
+    void addAscii(quint16 tag, const QByteArray& value) {
+        QByteArray data = value;
+        data.append('\0');
+        add(tag, EXIF_ASCII, quint32(data.size()), data);
+    }
+    void addLong(quint16 tag, quint32 value) {
+        QByteArray data(4, 0);
+        qToLittleEndian<quint32>(value, reinterpret_cast<uchar*>(data.data()));
+        add(tag, EXIF_LONG, 1, data);
+    }
+    void setLong(quint16 tag, quint32 value) {
+        for(int i=0; i<fields.size(); i++)
+            if(fields[i].tag == tag)
+                qToLittleEndian<quint32>(value, reinterpret_cast<uchar*>(fields[i].data.data()));
+    }
+    int size() const {
+        int nBytes = 2 + 12*fields.size() + 4;
+        for(int i=0; i<fields.size(); i++)
+            if(fields[i].data.size() > 4)
+                nBytes += (fields[i].data.size()+1) & ~1;
+        return nBytes;
+    }
+    // ifdOffset is relative to the TIFF header, as every EXIF offset
+    QByteArray build(quint32 ifdOffset) const {
+        QByteArray ifd(2 + 12*fields.size() + 4, 0);
+        QByteArray values;
+        uchar* p = reinterpret_cast<uchar*>(ifd.data());
+        quint32 valueOffset = ifdOffset + quint32(ifd.size());
+        qToLittleEndian<quint16>(quint16(fields.size()), p);
+        p += 2;
+        for(int i=0; i<fields.size(); i++, p+=12) {
+            const Field& field = fields[i];
+            qToLittleEndian<quint16>(field.tag, p);
+            qToLittleEndian<quint16>(field.type, p+2);
+            qToLittleEndian<quint32>(field.count, p+4);
+            if(field.data.size() <= 4) {
+                memcpy(p+8, field.data.constData(), size_t(field.data.size()));
+                continue;
+            }
+            qToLittleEndian<quint32>(valueOffset + quint32(values.size()), p+8);
+            values.append(field.data);
+            if(values.size() & 1)// Values start on word boundaries
+                values.append('\0');
+        }
+        // Next IFD offset (0) already there
+        return ifd + values;
+    }
+
+private:
+    struct Field {
+        quint16    tag;
+        quint16    type;
+        quint32    count;
+        QByteArray data;
+    };
+    void add(quint16 tag, quint16 type, quint32 count, const QByteArray& data) {
+        Field field = { tag, type, count, data };
+        fields.append(field);// Must be added in increasing tag order
+    }
+    QVector<Field> fields;
+};
+
+
+static QByteArray
+exifDateTime(qint64 msec) {
+    return QDateTime::fromMSecsSinceEpoch(msec).toString("yyyy:MM:dd HH:mm:ss").toLatin1();
+}
+
+
+static QString
+isoDateTime(qint64 msec) {
+    return QDateTime::fromMSecsSinceEpoch(msec).toString(Qt::ISODateWithMs);
+}
+
+
+QByteArray
+JpegMetadata::exifPayload(const FrameMetadata& metadata) {
+    QByteArray sDescription = QString("Session %1 frame %2")
+                              .arg(metadata.sSessionId)
+                              .arg(metadata.frameNum)
+                              .toLatin1();
+    QByteArray sUniqueId = QCryptographicHash::hash(sDescription, QCryptographicHash::Md5).toHex();
+
+    TiffIfd ifd0;
+    ifd0.addAscii(0x010E, sDescription);                       // ImageDescription
+    ifd0.addAscii(0x0131, QByteArray("ImageSequence"));        // Software
+    ifd0.addAscii(0x0132, exifDateTime(metadata.msecTriggered));// DateTime
+    ifd0.addLong (0x8769, 0);                                  // Exif IFD (set below)
+    quint32 exifOffset = 8 + quint32(ifd0.size());
+    ifd0.setLong(0x8769, exifOffset);
+    TiffIfd exifIfd;
+    exifIfd.addAscii(0x9003, exifDateTime(metadata.msecTriggered));// DateTimeOriginal
+    exifIfd.addAscii(0x9291, QByteArray::number(metadata.msecTriggered % 1000)
+                             .rightJustified(3, '0'));             // SubSecTimeOriginal
+    exifIfd.addAscii(0xA420, sUniqueId);                           // ImageUniqueID
+
+    QByteArray payload("Exif\0\0", 6);
+    payload.append("II*\0", 4);                   // Little endian TIFF
+    payload.append("\x08\0\0\0", 4);              // IFD0 right after the header
+    payload.append(ifd0.build(8));
+    payload.append(exifIfd.build(exifOffset));
+    return payload;
+}
+
+
+QByteArray
+JpegMetadata::xmpPayload(const FrameMetadata& metadata) {
+    QString sXmp = QString(
+        "<?xpacket begin=\"\xEF\xBB\xBF\" id=\"W5M0MpCehiHzreSzNTczkc9d\"?>"
+        "<x:xmpmeta xmlns:x=\"adobe:ns:meta/\">"
+        "<rdf:RDF xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\">"
+        "<rdf:Description rdf:about=\"\" xmlns:iseq=\"" XMP_NAMESPACE "\""
+        " iseq:SessionID=\"%1\""
+        " iseq:Frame=\"%2\""
+        " iseq:Scheduled=\"%3\""
+        " iseq:Triggered=\"%4\""
+        " iseq:TriggerDelay=\"%5\""
+        " iseq:Lamp=\"%6\""
+        " iseq:PanPulseWidth=\"%7\""
+        " iseq:TiltPulseWidth=\"%8\"/>"
+        "</rdf:RDF>"
+        "</x:xmpmeta>"
+        "<?xpacket end=\"w\"?>")
+        .arg(metadata.sSessionId.toHtmlEscaped())
+        .arg(metadata.frameNum)
+        .arg(metadata.msecScheduled ? isoDateTime(metadata.msecScheduled) : QString())
+        .arg(isoDateTime(metadata.msecTriggered))
+        .arg(metadata.msecScheduled ? metadata.msecTriggered-metadata.msecScheduled : 0)
+        .arg(metadata.bLampOn ? "On" : "Off")
+        .arg(metadata.panPulseWidth)
+        .arg(metadata.tiltPulseWidth);
+    QByteArray payload("http://ns.adobe.com/xap/1.0/\0", 29);
+    payload.append(sXmp.toUtf8());
+    return payload;
+}
+
+
+QByteArray
+JpegMetadata::segments(const FrameMetadata& metadata, bool bExif) {
+    QByteArray result;
+    QByteArray payloads[2];
+    int nPayloads = 0;
+    if(bExif)
+        payloads[nPayloads++] = exifPayload(metadata);
+    payloads[nPayloads++] = xmpPayload(metadata);
+    for(int i=0; i<nPayloads; i++) {
+        if(payloads[i].size() > MAX_SEGMENT)
+            continue;
+        uchar marker[4] = { 0xFF, 0xE1, 0, 0 };
+        qToBigEndian<quint16>(quint16(payloads[i].size()+2), marker+2);
+        result.append(reinterpret_cast<const char*>(marker), 4);
+        result.append(payloads[i]);
+    }
+    return result;
+}
+
+
+// Offset just past the SOI and the APP0/APP1 segments that follow it,
+// -1 if this is not a JPEG or the headers do not fit in size bytes.
+int
+JpegMetadata::headerEnd(const uchar* pData, int size, bool* pHasExif) {
+    *pHasExif = false;
+    if((size < 4) || (pData[0] != 0xFF) || (pData[1] != 0xD8))
+        return -1;
+    int i = 2;
+    while(i+4 <= size) {
+        if(pData[i] != 0xFF)
+            return -1;
+        if((pData[i+1] != 0xE0) && (pData[i+1] != 0xE1))
+            return i;
+        int length = (pData[i+2] << 8) | pData[i+3];
+        if((pData[i+1] == 0xE1) &&
+           (length >= 8) && (i+10 <= size) &&
+           !memcmp(pData+i+4, "Exif\0\0", 6))
+        {
+            *pHasExif = true;
+        }
+        i += 2 + length;
+    }
+    return -1;
+}
+
+
+bool
+JpegMetadata::write(const QString& sFileName,
+                    const char* pData,
+                    int size,
+                    const FrameMetadata& metadata)
+{
+    bool bHasExif;
+    int iSplice = headerEnd(reinterpret_cast<const uchar*>(pData), size, &bHasExif);
+    QFile file(sFileName);
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+    if(iSplice < 0)// Not for us: written as it is
+        return file.write(pData, size) == size;
+    QByteArray app1 = segments(metadata, !bHasExif);
+    return (file.write(pData, iSplice) == iSplice) &&
+           (file.write(app1) == app1.size()) &&
+           (file.write(pData+iSplice, size-iSplice) == size-iSplice);
+}
+
+
+// Everything after the headers is copied inside the kernel
+static bool
+copyRange(int fdIn, off_t offIn, int fdOut, off_t length) {
+#ifdef SYS_copy_file_range
+    while(length > 0) {
+        loff_t from = offIn;
+        ssize_t nCopied = syscall(SYS_copy_file_range, fdIn, &from, fdOut, Q_NULLPTR, size_t(length), 0);
+        if(nCopied <= 0)
+            break;// Not supported here (i.e. across filesystems): by hand
+        offIn  += nCopied;
+        length -= nCopied;
+    }
+#endif
+    QByteArray buffer(COPY_BLOCK, 0);
+    while(length > 0) {
+        ssize_t nRead = pread(fdIn, buffer.data(), size_t(qMin(off_t(COPY_BLOCK), length)), offIn);
+        if(nRead <= 0)
+            return false;
+        if(::write(fdOut, buffer.constData(), size_t(nRead)) != nRead)
+            return false;
+        offIn  += nRead;
+        length -= nRead;
+    }
+    return true;
+}
+
+
+// sDestination is written to a temporary file and then renamed, so it
+// never appears incomplete. sSource is left untouched.
+bool
+JpegMetadata::copy(const QString& sSource,
+                   const QString& sDestination,
+                   const FrameMetadata& metadata)
+{
+    QByteArray sIn  = QFile::encodeName(sSource);
+    QByteArray sOut = QFile::encodeName(sDestination);
+    QByteArray sTmp = sOut + "~";
+    int fdIn = open(sIn.constData(), O_RDONLY|O_CLOEXEC);
+    if(fdIn < 0)
+        return false;
+    struct stat info;
+    if(fstat(fdIn, &info) != 0) {
+        close(fdIn);
+        return false;
+    }
+    QByteArray header(int(qMin(off_t(HEADER_PEEK), info.st_size)), 0);
+    ssize_t nHeader = pread(fdIn, header.data(), size_t(header.size()), 0);
+    bool bHasExif = false;
+    int iSplice = (nHeader == header.size()) ?
+                  headerEnd(reinterpret_cast<const uchar*>(header.constData()), header.size(), &bHasExif) :
+                  -1;
+    if(iSplice < 0) {
+        close(fdIn);
+        return false;
+    }
+    QByteArray app1 = segments(metadata, !bHasExif);
+
+    int fdOut = open(sTmp.constData(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+    if(fdOut < 0) {
+        close(fdIn);
+        return false;
+    }
+    bool bOk = (::write(fdOut, header.constData(), size_t(iSplice)) == iSplice) &&
+               (::write(fdOut, app1.constData(), size_t(app1.size())) == app1.size()) &&
+               copyRange(fdIn, iSplice, fdOut, info.st_size-iSplice);
+    close(fdIn);
+    bOk = (close(fdOut) == 0) && bOk;
+    if(!bOk || (rename(sTmp.constData(), sOut.constData()) != 0)) {
+        unlink(sTmp.constData());
+        return false;
+    }
+    return true;
+}
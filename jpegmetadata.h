@@ -0,0 +1,49 @@
+#ifndef JPEGMETADATA_H
+#define JPEGMETADATA_H
+
+#include <QString>
+#include <QByteArray>
+#include <QMetaType>
+
+
+// What we know about a frame when it is triggered
+struct FrameMetadata
+{
+    QString sSessionId;
+    int     frameNum;
+    qint64  msecScheduled;  // Grid slot of the frame (ms since Epoch, 0 = unknown)
+    qint64  msecTriggered;  // When the camera has been triggered (ms since Epoch)
+    bool    bLampOn;
+    int     panPulseWidth;  // in us
+    int     tiltPulseWidth; // in us
+};
+Q_DECLARE_METATYPE(FrameMetadata)
+
+
+// Adds the FrameMetadata to a JPEG as APP1 segments (EXIF and XMP).
+// The segments are spliced right after the SOI and the APP0/APP1 already
+// present: only the headers are rewritten, the compressed data are copied
+// as they are (by the kernel, when the source is a file).
+// The EXIF segment is added only when the JPEG has none (raspistill
+// writes its own, the video port frames have none).
+class JpegMetadata
+{
+public:
+    static bool write(const QString& sFileName,
+                      const char* pData,
+                      int size,
+                      const FrameMetadata& metadata);
+    static bool copy(const QString& sSource,
+                     const QString& sDestination,
+                     const FrameMetadata& metadata);
+
+    // Both used by write() and copy(): public for the benchmarks
+    static int headerEnd(const uchar* pData, int size, bool* pHasExif);
+    static QByteArray segments(const FrameMetadata& metadata, bool bExif);
+
+protected:
+    static QByteArray exifPayload(const FrameMetadata& metadata);
+    static QByteArray xmpPayload(const FrameMetadata& metadata);
+};
+
+#endif // JPEGMETADATA_H
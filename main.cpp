@@ -1,12 +1,135 @@
 #include "mainwindow.h"
+#include "sessionreplay.h"
+#include "clock.h"
+#include "gpio.h"
+#include "configstore.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QJsonDocument>
 #include <QDebug>
+#include <string.h>
+#include <stdio.h>
+
+
+struct ReplayOptions
+{
+    double hours;        // 0 = No replay: the normal application
+    int    msecInterval;
+    bool   bContinuous;
+    int    crashAfter;
+    int    hangAfter;
+};
+
+
+// Several instances can run on the same machine (i.e. to try the
+// multi-node synchronization over loopback): every --instance has its
+// own settings and its own session checkpoint.
+static void
+parseCommandLine(QApplication& app, ReplayOptions* pReplay, QVariantMap* pSettings) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Time lapse recorder");
+    parser.addHelpOption();
+    QCommandLineOption instanceOption("instance",
+                                      "Run as a separate instance with its own settings.",
+                                      "name");
+    QCommandLineOption syncOption("sync",
+                                  "Multi-node synchronization: off, leader or follower.",
+                                  "mode");
+    QCommandLineOption leaderOption("leader",
+                                    "Address of the sync leader (follower only).",
+                                    "host:port");
+    QCommandLineOption portOption("port",
+                                  "UDP port of the sync leader (leader only).",
+                                  "port");
+    QCommandLineOption nodeOption("node",
+                                  "Name of this node in the sync statistics.",
+                                  "name");
+    QCommandLineOption replayOption("replay",
+                                    "Replay a session on a virtual clock and report (no camera, no GPIO).",
+                                    "hours");
+    QCommandLineOption intervalOption("interval",
+                                      "Replay: interval between frames.",
+                                      "ms", "10000");
+    QCommandLineOption continuousOption("continuous",
+                                        "Replay: continuous mode.");
+    QCommandLineOption crashOption("crash-after",
+                                   "Replay: the camera crashes after n frames.",
+                                   "n", "0");
+    QCommandLineOption hangOption("hang-after",
+                                  "Replay: the camera hangs after n frames.",
+                                  "n", "0");
+    parser.addOption(instanceOption);
+    parser.addOption(syncOption);
+    parser.addOption(leaderOption);
+    parser.addOption(portOption);
+    parser.addOption(nodeOption);
+    parser.addOption(replayOption);
+    parser.addOption(intervalOption);
+    parser.addOption(continuousOption);
+    parser.addOption(crashOption);
+    parser.addOption(hangOption);
+    parser.process(app);
+
+    pReplay->hours        = parser.value(replayOption).toDouble();
+    pReplay->msecInterval = qMax(100, parser.value(intervalOption).toInt());
+    pReplay->bContinuous  = parser.isSet(continuousOption);
+    pReplay->crashAfter   = parser.value(crashOption).toInt();
+    pReplay->hangAfter    = parser.value(hangOption).toInt();
+    if(pReplay->hours > 0.0) {// Never touch the checkpoint of the real runs
+        app.setApplicationName(app.applicationName() + QString("-replay"));
+        return;
+    }
+
+    if(parser.isSet(instanceOption))
+        app.setApplicationName(app.applicationName() +
+                               QString("-") +
+                               parser.value(instanceOption));
+    // For this run only: a test as leader or follower must not stay so
+    if(parser.isSet(syncOption))
+        pSettings->insert(Config::SyncMode.sName, parser.value(syncOption));
+    if(parser.isSet(leaderOption))
+        pSettings->insert(Config::SyncLeader.sName, parser.value(leaderOption));
+    if(parser.isSet(portOption))
+        pSettings->insert(Config::SyncPort.sName, parser.value(portOption));
+    if(parser.isSet(nodeOption))
+        pSettings->insert(Config::NodeName.sName, parser.value(nodeOption));
+}
+
+
+static int
+runReplay(const ReplayOptions& options) {
+    SessionReplay replay(options.msecInterval,
+                         int(options.hours*3600.0),
+                         options.bContinuous);
+    replay.setCrashAfter(options.crashAfter);
+    replay.setHangAfter(options.hangAfter);
+    ReplayReport report;
+    bool bPassed = replay.run(&report);
+    QByteArray json = QJsonDocument(report.toJson()).toJson();
+    fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    return bPassed ? 0 : 1;
+}
 
 
 int
 main(int argc, char *argv[]) {
+    for(int i=1; i<argc; i++) {// The replay needs no display
+        if(strncmp(argv[i], "--replay", 8) == 0)
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
     QApplication a(argc, argv);
-    MainWindow w;
+    ReplayOptions replayOptions;
+    QVariantMap commandLineSettings;
+    parseCommandLine(a, &replayOptions, &commandLineSettings);
+    if(replayOptions.hours > 0.0)
+        return runReplay(replayOptions);
+
+    ConfigStore config(Clock::system());
+    QString sError;
+    if(!config.setOverrides(commandLineSettings, &sError))
+        qWarning() << "Ignored the command line settings:" << sError;
+    PigpioGpio gpio;
+    MainWindow w(Clock::system(), &gpio, &config);
     w.show();
 
     int iRes = a.exec();
@@ -2,19 +2,25 @@
 #include "ui_mainwindow.h"
 #include "pigpiod_if2.h"// The library for using GPIO pins on Raspberry
 #include "setupdialog.h"
-#include <signal.h>
-#include <QMoveEvent>
 #include <QMessageBox>
-#include <QStandardPaths>
-#include <QSettings>
 #include <QThread>
 #include <QDebug>
 #include <QDir>
+#include <QFile>
+#include <QUuid>
+#include <QHostInfo>
 
 
-#define MIN_INTERVAL 1500 // in ms (depends on the image format: jpeg is HW accelerated !)
 #define IMAGE_QUALITY 100 // 100 is Best quality
 
+// Continuous (video port) capture
+#define FRAME_BUFFERS       6             // Frames that can be in flight at once
+#define FRAME_BUFFER_SIZE   (2*1024*1024) // Enough for a 1920x1080 MJPEG frame
+
+#define HEARTBEAT_INTERVALS 3             // Recorder dead after 3 intervals without frames
+#define GOVERNOR_PERIOD     2000          // in ms
+#define SETUP_PREVIEW_FPS   15            // While aiming the camera
+
 
 // ================================================
 // GPIO Numbers are Broadcom (BCM) numbers
@@ -26,20 +32,23 @@
 #define LED_PIN  23 // BCM23 is Pin 16 in the 40 pin GPIO connector.
 
 
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(Clock* pClock, Gpio* pGpio, ConfigStore* pConfig, QWidget *parent)
     : QMainWindow(parent)
     , pUi(new Ui::MainWindow)
-    , pImageRecorder(Q_NULLPTR)
+    , pSupervisor(Q_NULLPTR)
+    , pCheckpoint(Q_NULLPTR)
+    , pSyncNode(Q_NULLPTR)
+    , pGovernor(Q_NULLPTR)
+    , pPreview(Q_NULLPTR)
     , gpioLEDpin(LED_PIN)
-    , gpioHostHandle(-1)
+    , pClock(pClock)
+    , pGpio(pGpio)
+    , pConfig(pConfig)
+    , bLampOn(false)
 {
     pUi->setupUi(this);
     setFixedSize(size());
 
-    dialogPos = pos();
-    videoPos  = pUi->labelVideo->pos();
-    videoSize = pUi->labelVideo->size();
-
     restoreSettings();
 
     // Setup the QLineEdit styles
@@ -68,142 +77,280 @@ MainWindow::MainWindow(QWidget *parent)
     if(!gpioInit())
         exit(EXIT_FAILURE);
 
-    pSetupDlg = new setupDialog(gpioHostHandle);
+    pSetupDlg = new setupDialog(pGpio, pClock, pConfig);
+    pSetupDlg->setPreviewSource([this](QObject* pParent) {
+        return createPreviewRecorder(pParent);
+    });
+
+    pFramePool     = new FrameBufferPool(FRAME_BUFFERS, FRAME_BUFFER_SIZE);
+    pStreamCapture = new StreamCapture(pFramePool, this);
+    connect(pStreamCapture,
+            SIGNAL(frameCaptured(FrameBuffer*)),
+            this,
+            SLOT(onFrameCaptured(FrameBuffer*)));
+
+    // The frames are shown in labelVideo, decoded in their own thread
+    pPreview = new PreviewRenderer(pUi->labelVideo, pClock, this);
+    pPreview->setMaxFps(previewFps);
+    connect(pStreamCapture,
+            SIGNAL(frameSeen(const char*, int)),
+            pPreview,
+            SLOT(showFrame(const char*, int)),
+            Qt::DirectConnection);
+
+    // The output profiles are produced in a worker thread
+    qRegisterMetaType<FrameBuffer*>("FrameBuffer*");
+    qRegisterMetaType<FrameMetadata>("FrameMetadata");
+    pPipeline = new FramePipeline(pFramePool);
+    pPipeline->moveToThread(&pipelineThread);
+    connect(&pipelineThread,
+            SIGNAL(finished()),
+            pPipeline,
+            SLOT(deleteLater()));
+    connect(this,
+            SIGNAL(frameToProcess(FrameBuffer*, FrameMetadata)),
+            pPipeline,
+            SLOT(processBuffer(FrameBuffer*, FrameMetadata)));
+    connect(this,
+            SIGNAL(fileToProcess(FrameMetadata, QString)),
+            pPipeline,
+            SLOT(processFile(FrameMetadata, QString)));
+    connect(pPipeline,
+            SIGNAL(pipelineError(QString)),
+            this,
+            SLOT(onPipelineError(QString)));
+    connect(pPipeline,
+            SIGNAL(frameProcessed(int, QString)),
+            this,
+            SLOT(onFrameProcessed(int, QString)));
+    pipelineThread.start();
+
+    // The loose frames are rolled into chunk archives in the background
+    pPacker = new FramePacker();
+    pPacker->moveToThread(&packerThread);
+    connect(&packerThread,
+            SIGNAL(started()),
+            pPacker,
+            SLOT(lowerPriority()));
+    connect(&packerThread,
+            SIGNAL(finished()),
+            pPacker,
+            SLOT(deleteLater()));
+    connect(pPipeline,// Packed if the session says so
+            SIGNAL(frameProcessed(int, QString)),
+            pPacker,
+            SLOT(addFrame(int, QString)));
+    connect(pPacker,
+            SIGNAL(packerError(QString)),
+            this,
+            SLOT(onPipelineError(QString)));
+    packerThread.start();
+
+    // Backs off the background work when the Pi gets hot or the capture late
+    pGovernor = new ResourceGovernor(pClock, sSysfsRoot, this);
+    pGovernor->setThresholds(thermalWarm, thermalHot, loadPerCore, latencyBudget);
+    connect(pGovernor,
+            SIGNAL(encoderThreadsChanged(int)),
+            pPipeline,
+            SLOT(setEncoderThreads(int)));
+    connect(pGovernor,
+            SIGNAL(encodingPaused(bool)),
+            pPipeline,
+            SLOT(setEncodingPaused(bool)));
+    connect(pGovernor,
+            SIGNAL(packingPaused(bool)),
+            pPacker,
+            SLOT(setPaused(bool)));
+    connect(pGovernor,
+            SIGNAL(levelChanged(int, QString)),
+            this,
+            SLOT(onGovernorLevel(int, QString)));
+
+    // Keeps raspistill/raspivid running for the whole session
+    pSupervisor = new RecorderSupervisor(pClock, this);
+    pSupervisor->setFactory([this](QObject* pParent) {
+        return createRecorder(pParent);
+    });
+    connect(pSupervisor,
+            SIGNAL(recorderReady(Recorder*)),
+            this,
+            SLOT(onRecorderReady(Recorder*)));
+    connect(pSupervisor,
+            SIGNAL(recorderLost(int)),
+            this,
+            SLOT(onRecorderLost(int)));
+    connect(pSupervisor,
+            SIGNAL(recovered(qint64, int)),
+            this,
+            SLOT(onRecorderRecovered(qint64, int)));
+    connect(pSupervisor,
+            SIGNAL(finished(int)),
+            this,
+            SLOT(onRecorderFinished(int)));
+
+    // raspistill writes the frames by itself: we look for them
+    pFrameWatcher = new DirectoryWatcher(this);
+    connect(pFrameWatcher,
+            SIGNAL(fileArrived(QString)),
+            this,
+            SLOT(onNewImageFile(QString)));
 
     switchLampOff();
 
     // Init User Interface with restored values
-    pUi->pathEdit->setText(sBaseDir);
-    pUi->nameEdit->setText(sOutFileName);
+    showSessionSettings();
     pUi->startButton->setEnabled(true);
     pUi->stopButton->setDisabled(true);
-    pUi->intervalEdit->setText(QString("%1").arg(msecInterval));
-    pUi->tTimeEdit->setText(QString("%1").arg(secTotTime));
     pUi->labelVideo->setStyleSheet(sBlackStyle);
 
-    intervalTimer.stop();// Probably non needed but...does'nt hurt
-    connect(&intervalTimer,
+    // Whoever changes the settings (us, the setup dialog, an editor)
+    connect(pConfig,
+            SIGNAL(changed(QString, QVariant)),
+            this,
+            SLOT(onConfigChanged(QString, QVariant)));
+    connect(pConfig,
+            SIGNAL(writeFailed(QString)),
+            this,
+            SLOT(onPipelineError(QString)));
+
+    pIntervalTimer = pClock->createTimer(this);
+    pIntervalTimer->setSingleShot(true);// Rescheduled on the session grid
+    connect(pIntervalTimer,
             SIGNAL(timeout()),
             this,
             SLOT(onTimeToGetNewImage()));
+
+    // Was a session running when we went down ?
+    pCheckpoint = new SessionCheckpoint();
+    session.msecStart = 0;
+    session.msecEnd   = 0;
+    session.bRunning  = false;
+    stats = ScheduleStats();
+    if(pCheckpoint->load(&session) && session.bRunning)
+        QTimer::singleShot(0, this, SLOT(resumeSession()));
+
+    initSync();
+}
+
+
+// The threads are already joined if we were closed, not if destroyed
+// without a close(): the pool goes only once they are
+MainWindow::~MainWindow() {
+    pipelineThread.quit();
+    pipelineThread.wait();
+    packerThread.quit();
+    packerThread.wait();
+    delete pStreamCapture;// It gives its buffer back to the pool
+    delete pFramePool;
 }
 
 
 void
 MainWindow::closeEvent(QCloseEvent *event) {
     Q_UNUSED(event)
-    intervalTimer.stop();
-    if(pImageRecorder) {
-        pImageRecorder->terminate();
-        pImageRecorder->close();
-        pImageRecorder->waitForFinished(3000);
-        pImageRecorder->deleteLater();
-        pImageRecorder = nullptr;
-    }
+    pIntervalTimer->stop();
+    pStreamCapture->stop();
+    pFrameWatcher->stop();
+    pCheckpoint->clear();// Closed on purpose: nothing to resume
+    pSupervisor->shutdown();
+    pGovernor->stop();// Nothing is paused anymore
     switchLampOff();
-    // Save settings
-    QSettings settings;
-    settings.setValue("mainWindowState", saveState());
-    settings.setValue("BaseDir", sBaseDir);
-    settings.setValue("FileName", sOutFileName);
-    settings.setValue("Interval", msecInterval);
-    settings.setValue("TotalTime", secTotTime);
+    // Wait for the frames still in the pipeline (quit() would drop them)
+    QMetaObject::invokeMethod(pPipeline, "flush", Qt::BlockingQueuedConnection);
+    pipelineThread.quit();
+    pipelineThread.wait();
+    // Then for the frames still to be packed
+    QMetaObject::invokeMethod(pPacker, "flush", Qt::BlockingQueuedConnection);
+    packerThread.quit();
+    packerThread.wait();
+    // The settings are saved as they change: only the window is left
+    pConfig->setValue(Config::WindowState, saveState());
+    pConfig->flush();
     // Free GPIO
-    if(gpioHostHandle >= 0)
-        pigpio_stop(gpioHostHandle);
+    pGpio->stop();
 }
 
 
+// Already validated by the store
 void
-MainWindow::moveEvent(QMoveEvent *event) {
-    dialogPos = event->pos();
-    videoPos = pUi->labelVideo->pos();
-    videoSize = pUi->labelVideo->size();
-    if(pImageRecorder) {
-        QString sCommand = QString("/usr/bin/raspistill");
-        QStringList sArguments = QStringList();
-        sArguments.append(QString("-s"));                        // Acquire upon receiving a SIGUSR1 signal
-        sArguments.append(QString("-ex auto"));                  // Exposure mode; Auto
-        sArguments.append(QString("-awb auto"));                 // White Balance; Auto
-        sArguments.append(QString("-drc off"));                  // Dynamic Range Compression: off
-        sArguments.append(QString("-q %1").arg(IMAGE_QUALITY));  // JPEG quality: 100=max
-        sArguments.append(QString("-t %1").arg(secTotTime*1000));// Acquisition Time(0 = No limit)
-        sArguments.append(QString("-md 1"));                     // Mode 1 (1920x1080)
-        sArguments.append(QString("-vf"));                       // Vertical Flip
-        sArguments.append(QString("-dt"));                       // Date-Time file name
-        sArguments.append(QString("-o %1/%2_%d.jpg")             // File name(s)
-                          .arg(sBaseDir)
-                          .arg(sOutFileName));
-        sArguments.append(QString("-p %1,%2,%3,%4")
-                          .arg(dialogPos.x()+videoPos.x())
-                          .arg(dialogPos.y()+videoPos.y())
-                          .arg(videoSize.width())
-                          .arg(videoSize.height()));
-////////////////////////////////////////////////////////////
-/// Here we could use the following (Not working at present)
-//    pImageRecorder->setProgram(sCommand);
-//    pImageRecorder->setArguments(sArguments);
-//    pImageRecorder->start();
-/// Instead we have to use:
-        for(int i=0; i<sArguments.size(); i++)
-            sCommand += QString(" %1").arg(sArguments[i]);
-////////////////////////////////////////////////////////////
-        if(pImageRecorder->state() == QProcess::NotRunning)
-            pImageRecorder->start(sCommand);
-        else {
-            pImageRecorder->disconnect();
-            pImageRecorder->terminate();
-            pImageRecorder->close();
-            pImageRecorder->waitForFinished(3000);
-            delete pImageRecorder;
-            pImageRecorder = new QProcess(this);
-            connect(pImageRecorder,
-                    SIGNAL(finished(int, QProcess::ExitStatus)),
-                    this,
-                    SLOT(onImageRecorderClosed(int, QProcess::ExitStatus)));
-            connect(pImageRecorder,
-                    SIGNAL(errorOccurred(QProcess::ProcessError)),
-                    this,
-                    SLOT(onImageRecorderError(QProcess::ProcessError)));
-            connect(pImageRecorder,
-                    SIGNAL(started()),
-                    this,
-                    SLOT(onImageRecorderStarted()));
-            pImageRecorder->start(sCommand);
-        }
-    }
+MainWindow::restoreSettings() {
+    loadSessionSettings();
+    loadGovernorSettings();
+    previewFps      = pConfig->value(Config::PreviewFps);
+
+    // Restore State of the window
+    restoreState(pConfig->value(Config::WindowState));
+    outputProfiles  = OutputProfile::restore(pConfig->value(Config::OutputProfiles));
 }
 
 
+// What the next session will use
 void
-MainWindow::restoreSettings() {
-    QSettings settings;
-    // Restore settings
-    sBaseDir        = settings.value("BaseDir",
-                                     QStandardPaths::writableLocation(QStandardPaths::PicturesLocation)).toString();
-    sOutFileName    = settings.value("FileName",
-                                     QString("test")).toString();
-    msecInterval    = settings.value("Interval", 10000).toInt();
-    secTotTime      = settings.value("TotalTime", 0).toInt();
+MainWindow::loadSessionSettings() {
+    sBaseDir         = pConfig->value(Config::BaseDir);
+    sOutFileName     = pConfig->value(Config::FileName);
+    msecInterval     = pConfig->value(Config::Interval);
+    secTotTime       = pConfig->value(Config::TotalTime);
+    bContinuous      = pConfig->value(Config::Continuous);
+    bSimulatedCamera = pConfig->value(Config::SimulatedCamera);
+    checkpointFrames = pConfig->value(Config::CheckpointFrames);
+    bPackFrames      = pConfig->value(Config::PackFrames);
+    chunkMBytes      = pConfig->value(Config::ChunkSizeMB);
+    packerKBytes     = pConfig->value(Config::PackerRateKBs);
+    sSysfsRoot       = pConfig->value(Config::SysfsRoot);
+}
 
-    // Restore State of the window
-    restoreState(settings.value("mainWindowState").toByteArray());
+
+void
+MainWindow::loadGovernorSettings() {
+    thermalWarm   = pConfig->value(Config::ThermalWarm);
+    thermalHot    = pConfig->value(Config::ThermalHot);
+    loadPerCore   = pConfig->value(Config::LoadPerCore);
+    latencyBudget = pConfig->value(Config::LatencyBudget);
+}
+
+
+// Leaves alone what is being typed, if it already says the same
+void
+MainWindow::showSessionSettings() {
+    if(pUi->pathEdit->text() != sBaseDir)
+        pUi->pathEdit->setText(sBaseDir);
+    if(pUi->nameEdit->text() != sOutFileName)
+        pUi->nameEdit->setText(sOutFileName);
+    if(pUi->intervalEdit->text().toInt() != msecInterval)
+        pUi->intervalEdit->setText(QString("%1").arg(msecInterval));
+    if(pUi->tTimeEdit->text().toInt() != secTotTime)
+        pUi->tTimeEdit->setText(QString("%1").arg(secTotTime));
+    pUi->continuousBox->setChecked(bContinuous);
+}
+
+
+// A resumed or followed session: its parameters are the new settings
+void
+MainWindow::storeSessionSettings() {
+    QVariantMap settings;
+    settings[Config::BaseDir.sName]    = sBaseDir;
+    settings[Config::FileName.sName]   = sOutFileName;
+    settings[Config::Continuous.sName] = bContinuous;
+    settings[Config::Interval.sName]   = msecInterval;
+    settings[Config::TotalTime.sName]  = secTotTime;
+    QString sError;
+    if(!pConfig->setValues(settings, &sError))
+        pUi->statusBar->showMessage(QString("Session settings not remembered: %1").arg(sError));
 }
 
 
 bool
 MainWindow::gpioInit() {
     int iResult;
-    gpioHostHandle = pigpio_start(QString("localhost").toLocal8Bit().data(),
-                                  QString("8888").toLocal8Bit().data());
-    if(gpioHostHandle < 0) {
+    if(pGpio->start() < 0) {
         QMessageBox::critical(this,
                               QString("pigpiod Error !"),
                               QString("Non riesco ad inizializzare la GPIO."));
         return false;
     }
     // Led On/Off Control
-    iResult = set_mode(gpioHostHandle, gpioLEDpin, PI_OUTPUT);
+    iResult = pGpio->setMode(gpioLEDpin, PI_OUTPUT);
     if(iResult < 0) {
         QMessageBox::critical(this,
                               QString("pigpiod Error"),
@@ -212,7 +359,7 @@ MainWindow::gpioInit() {
         return false;
     }
 
-    iResult = set_pull_up_down(gpioHostHandle, gpioLEDpin, PI_PUD_UP);
+    iResult = pGpio->setPullUpDown(gpioLEDpin, PI_PUD_UP);
     if(iResult < 0) {
         QMessageBox::critical(this,
                               QString("pigpiod Error"),
@@ -226,13 +373,14 @@ MainWindow::gpioInit() {
 
 void
 MainWindow::switchLampOn() {
-    if(gpioHostHandle >= 0)
-        gpio_write(gpioHostHandle, gpioLEDpin, 1);
+    if(pGpio->isConnected())
+        pGpio->write(gpioLEDpin, 1);
     else
         QMessageBox::critical(this,
                               QString("pigpiod Error"),
                               QString("Unable to set GPIO%1 On")
                               .arg(gpioLEDpin));
+    bLampOn = true;
     pUi->lampStatus->setStyleSheet(sPhotoStyle);
     repaint();
 }
@@ -240,18 +388,145 @@ MainWindow::switchLampOn() {
 
 void
 MainWindow::switchLampOff() {
-    if(gpioHostHandle >= 0)
-        gpio_write(gpioHostHandle, gpioLEDpin, 0);
+    if(pGpio->isConnected())
+        pGpio->write(gpioLEDpin, 0);
     else
         QMessageBox::critical(this,
                               QString("pigpiod Error"),
                               QString("Unable to set GPIO%1 Off")
                               .arg(gpioLEDpin));
+    bLampOn = false;
     pUi->lampStatus->setStyleSheet(sDarkStyle);
     repaint();
 }
 
 
+int
+MainWindow::streamFps() {
+    return qBound(1, 2000/msecInterval, MAX_STREAM_FPS);
+}
+
+
+Recorder*
+MainWindow::createRecorder(QObject* pParent) {
+    if(!bSimulatedCamera)
+        return new ProcessRecorder(recorderCommand(), bContinuous, pParent);
+    SimulatedRecorder* pRecorder = new SimulatedRecorder(stagingDir(),
+                                                         sOutFileName,
+                                                         streamFps(),
+                                                         bContinuous,
+                                                         pClock,
+                                                         pParent);
+    // Fault injection, to exercise the recovery
+    pRecorder->setStartupTime(pConfig->value(Config::SimulatedStartup));
+    pRecorder->crashAfter(pConfig->value(Config::SimulatedCrashAfter));
+    pRecorder->hangAfter(pConfig->value(Config::SimulatedHangAfter));
+    return pRecorder;
+}
+
+
+// For the setup dialog: a small stream, only to be looked at
+Recorder*
+MainWindow::createPreviewRecorder(QObject* pParent) {
+    if(!bSimulatedCamera)
+        return new ProcessRecorder(previewCommand(), true, pParent);
+    return new SimulatedRecorder(stagingDir(),
+                                 sOutFileName,
+                                 SETUP_PREVIEW_FPS,
+                                 true,
+                                 pClock,
+                                 pParent);
+}
+
+
+// raspistill writes here: the pipeline then moves every frame to the
+// output folder, with its metadata and its frame number as the name.
+QString
+MainWindow::stagingDir() {
+    return sBaseDir + QString("/.incoming");
+}
+
+
+QString
+MainWindow::recorderCommand() {
+    QString sCommand;
+    QStringList sArguments = QStringList();
+    if(bContinuous) {
+        sCommand = QString("/usr/bin/raspivid");
+        sArguments.append(QString("-cd MJPEG"));                 // Codec: Motion JPEG
+        sArguments.append(QString("-md 1"));                     // Mode 1 (1920x1080)
+        sArguments.append(QString("-w 1920"));
+        sArguments.append(QString("-h 1080"));
+        sArguments.append(QString("-fps %1").arg(streamFps()));  // Two frames per interval
+        sArguments.append(QString("-ex auto"));                  // Exposure mode; Auto
+        sArguments.append(QString("-awb auto"));                 // White Balance; Auto
+        sArguments.append(QString("-drc off"));                  // Dynamic Range Compression: off
+        sArguments.append(QString("-vf"));                       // Vertical Flip
+        sArguments.append(QString("-t %1").arg(msecRemaining()));// Acquisition Time(0 = No limit)
+        sArguments.append(QString("-o -"));                      // Stream to stdout
+    }
+    else {
+        sCommand = QString("/usr/bin/raspistill");
+        sArguments.append(QString("-s"));                        // Acquire upon receiving a SIGUSR1 signal
+        sArguments.append(QString("-ex auto"));                  // Exposure mode; Auto
+        sArguments.append(QString("-awb auto"));                 // White Balance; Auto
+        sArguments.append(QString("-drc off"));                  // Dynamic Range Compression: off
+        sArguments.append(QString("-q %1").arg(IMAGE_QUALITY));  // JPEG quality: 100=max
+        sArguments.append(QString("-t %1").arg(msecRemaining()));// Acquisition Time(0 = No limit)
+        sArguments.append(QString("-vf"));                       // Vertical Flip
+        sArguments.append(QString("-md 1"));                     // Mode 1 (1920x1080)
+        sArguments.append(QString("-dt"));                       // Date-Time file name
+        sArguments.append(QString("-o %1/%2_%d.jpg")             // File name(s)
+                          .arg(stagingDir())
+                          .arg(sOutFileName));
+    }
+    sArguments.append(QString("-n"));                            // No preview: we show the frames
+////////////////////////////////////////////////////////////
+/// Here we could use the following (Not working at present)
+//    pImageRecorder->setProgram(sCommand);
+//    pImageRecorder->setArguments(sArguments);
+//    pImageRecorder->start();
+/// Instead we have to use:
+    for(int i=0; i<sArguments.size(); i++)
+        sCommand += QString(" %1").arg(sArguments[i]);
+////////////////////////////////////////////////////////////
+    return sCommand;
+}
+
+
+QString
+MainWindow::previewCommand() {
+    QString sCommand = QString("/usr/bin/raspivid");
+    QStringList sArguments = QStringList();
+    sArguments.append(QString("-cd MJPEG"));                     // Codec: Motion JPEG
+    sArguments.append(QString("-md 1"));                         // Mode 1 (1920x1080)
+    sArguments.append(QString("-w 640"));
+    sArguments.append(QString("-h 360"));
+    sArguments.append(QString("-fps %1").arg(SETUP_PREVIEW_FPS));
+    sArguments.append(QString("-ex auto"));                      // Exposure mode; Auto
+    sArguments.append(QString("-awb auto"));                     // White Balance; Auto
+    sArguments.append(QString("-drc off"));                      // Dynamic Range Compression: off
+    sArguments.append(QString("-vf"));                           // Vertical Flip
+    sArguments.append(QString("-t 0"));                          // Until stopped
+    sArguments.append(QString("-n"));                            // No preview: we show the frames
+    sArguments.append(QString("-o -"));                          // Stream to stdout
+    for(int i=0; i<sArguments.size(); i++)
+        sCommand += QString(" %1").arg(sArguments[i]);
+    return sCommand;
+}
+
+
+// Recording time left in the session (0 = No limit)
+int
+MainWindow::msecRemaining() {
+    if(secTotTime == 0)
+        return 0;
+    if(session.msecStart == 0)// Not yet started
+        return secTotTime*1000;
+    return int(qMax(qint64(1), session.msecEnd-pClock->msecNow()));
+}
+
+
 bool
 MainWindow::checkValues() {
     QDir dir(sBaseDir);
@@ -265,38 +540,45 @@ MainWindow::checkValues() {
 /// Process event handlers <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 //////////////////////////////////////////////////////////////
 void
-MainWindow::onImageRecorderStarted() {
-    pid = pid_t(pImageRecorder->processId());
-    if(pid != 0) {
-        intervalTimer.start(msecInterval);
+MainWindow::onRecorderReady(Recorder* pRecorder) {
+    if(bContinuous) {
+        pStreamCapture->start(pRecorder->stream());
+        switchLampOn();// The lamp stays on for the whole run
     }
+    startSchedule();
 }
 
 
 void
-MainWindow::onImageRecorderError(QProcess::ProcessError error) {
-    Q_UNUSED(error)
-    pUi->statusBar->showMessage(QString("raspistill Error %1")
-                                .arg(error), 1000);
-    switchLampOff();
-    QList<QLineEdit *> widgets = findChildren<QLineEdit *>();
-    for(int i=0; i<widgets.size(); i++) {
-        widgets[i]->setEnabled(true);
-    }
-    pUi->startButton->setEnabled(true);
-    pUi->stopButton->setDisabled(true);
+MainWindow::onRecorderLost(int nOutstanding) {
+    Q_UNUSED(nOutstanding)
+    pendingFrames.clear();// They will never arrive
+    pStreamCapture->stop();
+    pUi->statusBar->showMessage(QString("Recorder lost: restarting..."), 2000);
+}
+
+
+void
+MainWindow::onRecorderRecovered(qint64 msecDowntime, int nLostFrames) {
+    pUi->statusBar->showMessage(QString("Recorder recovered in %1 ms (%2 frames lost)")
+                                .arg(msecDowntime)
+                                .arg(nLostFrames), 5000);
 }
 
 
 void
-MainWindow::onImageRecorderClosed(int exitCode, QProcess::ExitStatus exitStatus) {
-    intervalTimer.stop();
-    pImageRecorder->disconnect();
-    pImageRecorder->deleteLater();
-    pImageRecorder = nullptr;
+MainWindow::onRecorderFinished(int exitCode) {
+    pIntervalTimer->stop();
+    pStreamCapture->stop();
+    pFrameWatcher->stop();
+    pCheckpoint->clear();
+    session.bRunning = false;
+    publishSchedule();
+    pGovernor->stop();// Let the deferred work be done
+    QMetaObject::invokeMethod(pPipeline, "flush", Qt::QueuedConnection);
+    QMetaObject::invokeMethod(pPacker, "flush", Qt::QueuedConnection);
     if(exitCode != 130) {// exitStatus==130 means process killed by Ctrl-C
-        pUi->statusBar->showMessage(QString("raspistill exited with status: %1, Exit code: %2")
-                                    .arg(exitStatus)
+        pUi->statusBar->showMessage(QString("Recording finished, Exit code: %1")
                                     .arg(exitCode), 2000);
     }
     switchLampOff();
@@ -304,72 +586,132 @@ MainWindow::onImageRecorderClosed(int exitCode, QProcess::ExitStatus exitStatus)
     for(int i=0; i<widgets.size(); i++) {
         widgets[i]->setEnabled(true);
     }
+    pUi->continuousBox->setEnabled(true);
     pUi->setupButton->setEnabled(true);
-    pUi->startButton->setEnabled(true);
+    pUi->startButton->setEnabled(!isFollower());// The leader starts the followers
     pUi->stopButton->setDisabled(true);
+    // Changed while we were recording ?
+    loadSessionSettings();
+    showSessionSettings();
 }
 
 
 //////////////////////////////////////////////////////////////
 /// UI event handlers <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 //////////////////////////////////////////////////////////////
+// For who drives us without the UI (i.e. the session replay)
+void
+MainWindow::startRecording() {
+    on_startButton_clicked();
+}
+
+
+void
+MainWindow::stopRecording() {
+    if(session.bRunning)
+        on_stopButton_clicked();
+}
+
+
+bool
+MainWindow::isRecording() const {
+    return session.bRunning || pSupervisor->isRunning();
+}
+
+
 void
 MainWindow::on_startButton_clicked() {
     if(!checkValues()) {
         pUi->statusBar->showMessage((QString("Error: Check Values !")));
         return;
     }
-    imageNum = 0;
+    session.sSessionId   = QUuid::createUuid().toString();
+    session.msecStart    = 0;// Set when the recorder is ready
+    session.msecInterval = msecInterval;
+    session.secTotTime   = secTotTime;
+    session.msecEnd      = 0;
+    session.nCaptured    = 0;
+    session.nextFrame    = 0;
+    session.sBaseDir     = sBaseDir;
+    session.sOutFileName = sOutFileName;
+    session.bContinuous  = bContinuous;
+    session.bRunning     = true;
+    startSession();
+}
 
-    pImageRecorder = new QProcess(this);
-    connect(pImageRecorder,
-            SIGNAL(finished(int, QProcess::ExitStatus)),
-            this,
-            SLOT(onImageRecorderClosed(int, QProcess::ExitStatus)));
-    connect(pImageRecorder,
-            SIGNAL(errorOccurred(QProcess::ProcessError)),
-            this,
-            SLOT(onImageRecorderError(QProcess::ProcessError)));
-    connect(pImageRecorder,
-            SIGNAL(started()),
-            this,
-            SLOT(onImageRecorderStarted()));
 
-    QString sCommand = QString("/usr/bin/raspistill");
-    QStringList sArguments = QStringList();
-    sArguments.append(QString("-s"));                        // Acquire upon receiving a SIGUSR1 signal
-    sArguments.append(QString("-ex auto"));                  // Exposure mode; Auto
-    sArguments.append(QString("-awb auto"));                 // White Balance; Auto
-    sArguments.append(QString("-drc off"));                  // Dynamic Range Compression: off
-    sArguments.append(QString("-q %1").arg(IMAGE_QUALITY));  // JPEG quality: 100=max
-    sArguments.append(QString("-t %1").arg(secTotTime*1000));// Acquisition Time(0 = No limit)
-    sArguments.append(QString("-vf"));                       // Vertical Flip
-    sArguments.append(QString("-md 1"));                     // Mode 1 (1920x1080)
-    sArguments.append(QString("-dt"));                       // Date-Time file name
-    sArguments.append(QString("-o %1/%2_%d.jpg")             // File name(s)
-                      .arg(sBaseDir)
-                      .arg(sOutFileName));
-    sArguments.append(QString("-p %1,%2,%3,%4")
-                      .arg(dialogPos.x()+videoPos.x())
-                      .arg(dialogPos.y()+videoPos.y())
-                      .arg(videoSize.width())
-                      .arg(videoSize.height()));
+void
+MainWindow::resumeSession() {
+    sBaseDir     = session.sBaseDir;
+    sOutFileName = session.sOutFileName;
+    msecInterval = session.msecInterval;
+    secTotTime   = session.secTotTime;
+    bContinuous  = session.bContinuous;
+    storeSessionSettings();
+    showSessionSettings();
+    if((secTotTime > 0) && (msecRemaining() <= 1)) {// Expired while we were down
+        session.bRunning = false;// The settings may change again
+        pCheckpoint->clear();
+        return;
+    }
+    if(!checkValues()) {
+        session.bRunning = false;
+        pUi->statusBar->showMessage((QString("Unable to resume: Check Values !")));
+        return;
+    }
+    pUi->statusBar->showMessage(QString("Resuming session from frame %1")
+                                .arg(session.nextFrame), 3000);
+    startSession();
+}
 
-////////////////////////////////////////////////////////////
-/// Here we could use the following (Not working at present)
-//    pImageRecorder->setProgram(sCommand);
-//    pImageRecorder->setArguments(sArguments);
-//    pImageRecorder->start();
-/// Instead we have to use:
-    for(int i=0; i<sArguments.size(); i++)
-        sCommand += QString(" %1").arg(sArguments[i]);
-    pImageRecorder->start(sCommand);
-////////////////////////////////////////////////////////////
+
+// The frame numbers start again with every session: its id in the names
+// keeps a new session, in the same folder and with the same FileName, from
+// overwriting the frames and chunks of an old one. A resumed session keeps
+// its id, and so its names.
+QString
+MainWindow::sessionFileName() const {
+    return QString("%1_%2")
+           .arg(session.sOutFileName)
+           .arg(session.sSessionId.mid(1, 8));// {xxxxxxxx-...}
+}
+
+
+void
+MainWindow::startSession() {
+    pendingFrames.clear();
+    pPreview->clear();
+    stats = ScheduleStats();
+    saveCheckpoint();
+    outputProfiles = OutputProfile::restore(pConfig->value(Config::OutputProfiles));
+    pPipeline->setSession(sBaseDir, sessionFileName(), outputProfiles);
+    if(!bContinuous) {
+        pFramePool->trim();// Only the stream needs it: allocated again if so
+        QDir().mkpath(stagingDir());
+        pFrameWatcher->watch(stagingDir(), sOutFileName+QString("_"));
+    }
+
+    int msecHeartbeat = pConfig->value(Config::HeartbeatTimeout);
+    if(msecHeartbeat <= 0)
+        msecHeartbeat = HEARTBEAT_INTERVALS*msecInterval;
+    QMetaObject::invokeMethod(pPacker,
+                              "startSession",
+                              Qt::QueuedConnection,
+                              Q_ARG(QString, sBaseDir),
+                              Q_ARG(QString, sessionFileName()),
+                              Q_ARG(bool, bPackFrames),
+                              Q_ARG(qint64, qint64(chunkMBytes)*1024*1024),
+                              Q_ARG(int, packerKBytes*1024));
+    pSupervisor->setHeartbeatTimeout(msecHeartbeat);
+    pSupervisor->start();
+    pGovernor->setSysRoot(sSysfsRoot);
+    pGovernor->start(GOVERNOR_PERIOD);
 
     QList<QLineEdit *> widgets = findChildren<QLineEdit *>();
     for(int i=0; i<widgets.size(); i++) {
         widgets[i]->setDisabled(true);
     }
+    pUi->continuousBox->setDisabled(true);
     pUi->setupButton->setDisabled(true);
     pUi->startButton->setDisabled(true);
     pUi->stopButton->setEnabled(true);
@@ -378,20 +720,11 @@ MainWindow::on_startButton_clicked() {
 
 void
 MainWindow::on_stopButton_clicked() {
-    intervalTimer.stop();
-    if(pImageRecorder) {
-        kill(pid, SIGINT);
-    }
-    else {
-        switchLampOff();
-        QList<QLineEdit *> widgets = findChildren<QLineEdit *>();
-        for(int i=0; i<widgets.size(); i++) {
-            widgets[i]->setEnabled(true);
-        }
-        pUi->startButton->setEnabled(true);
-        pUi->setupButton->setEnabled(true);
-        pUi->stopButton->setDisabled(true);
-    }
+    pIntervalTimer->stop();
+    session.bRunning = false;
+    pCheckpoint->clear();
+    publishSchedule();
+    pSupervisor->stop();// onRecorderFinished() will follow
 }
 
 
@@ -401,12 +734,14 @@ MainWindow::on_setupButton_clicked() {
 }
 
 
+// The store validates: msecInterval follows through onConfigChanged()
 void
 MainWindow::on_intervalEdit_textEdited(const QString &arg1) {
-    if(arg1.toInt() < MIN_INTERVAL) {
+    QString sError;
+    if(!pConfig->setValue(Config::Interval, arg1.toInt(), &sError)) {
         pUi->intervalEdit->setStyleSheet(sErrorStyle);
+        pUi->statusBar->showMessage(sError, 2000);
     } else {
-        msecInterval = arg1.toInt();
         pUi->intervalEdit->setStyleSheet(sNormalStyle);
     }
 }
@@ -421,10 +756,11 @@ MainWindow::on_intervalEdit_editingFinished() {
 
 void
 MainWindow::on_tTimeEdit_textEdited(const QString &arg1) {
-    if(arg1.toInt() < 0) {
+    QString sError;
+    if(!pConfig->setValue(Config::TotalTime, arg1.toInt(), &sError)) {
         pUi->tTimeEdit->setStyleSheet(sErrorStyle);
+        pUi->statusBar->showMessage(sError, 2000);
     } else {
-        secTotTime = arg1.toInt();
         pUi->tTimeEdit->setStyleSheet(sNormalStyle);
     }
 }
@@ -437,6 +773,18 @@ MainWindow::on_tTimeEdit_editingFinished() {
 }
 
 
+void
+MainWindow::on_continuousBox_toggled(bool checked) {
+    // Together: the stills refuse a stream interval
+    QVariantMap changes;
+    changes[Config::Continuous.sName] = checked;
+    int msecMin = Config::minInterval(checked);
+    if(pConfig->value(Config::Interval) < msecMin)
+        changes[Config::Interval.sName] = msecMin;
+    pConfig->setValues(changes);
+}
+
+
 void
 MainWindow::on_pathEdit_textChanged(const QString &arg1) {
     QDir dir(arg1);
@@ -451,13 +799,13 @@ MainWindow::on_pathEdit_textChanged(const QString &arg1) {
 
 void
 MainWindow::on_pathEdit_editingFinished() {
-    sBaseDir = pUi->pathEdit->text();
+    pConfig->setValue(Config::BaseDir, pUi->pathEdit->text());
 }
 
 
 void
 MainWindow::on_nameEdit_textChanged(const QString &arg1) {
-    sOutFileName = arg1;
+    pConfig->setValue(Config::FileName, arg1);
 }
 
 
@@ -466,14 +814,370 @@ MainWindow::on_nameEdit_textChanged(const QString &arg1) {
 //////////////////////////////////////////////////////////////
 void
 MainWindow::onTimeToGetNewImage() {
-    switchLampOn();
-    QThread::msleep(10);
-    int iErr = kill(pid, SIGUSR1);
-    if(iErr == -1) {
-        pUi->statusBar->showMessage(QString("Error %1 in sending SIGUSR1 signal")
-                                    .arg(iErr), 2000);
-    }
-    QThread::msleep(300);
-    switchLampOff();
+    int frameNum = session.nextFrame++;
+    int msecLateness = int(pClock->msecNow() - (session.msecStart + qint64(frameNum)*msecInterval));
+    stats.nTriggers++;
+    stats.msecLatenessSum += msecLateness;
+    stats.msecMaxLateness  = qMax(stats.msecMaxLateness, msecLateness);
+    if(isFollower())// How late we are on the shared schedule
+        pSyncNode->frameTriggered(msecLateness);
+    pGovernor->reportLatency(msecLateness);
+    if(bContinuous) {// The lamp stays on for the whole run
+        if(pSupervisor->trigger()) {
+            if(pStreamCapture->grabNextFrame())
+                pendingFrames.enqueue(frameMetadata(frameNum));
+            else
+                pSupervisor->frameDropped();
+        }
+    }
+    else {
+        switchLampOn();
+        pClock->sleep(10);
+        if(pSupervisor->trigger())
+            pendingFrames.enqueue(frameMetadata(frameNum));
+        else
+            pUi->statusBar->showMessage(QString("Unable to trigger frame %1")
+                                        .arg(frameNum), 2000);
+        pClock->sleep(300);
+        switchLampOff();
+    }
+    if((frameNum % checkpointFrames) == 0)
+        saveCheckpoint();
+    scheduleNextImage();
+}
+
+
+// The first frame is taken one interval after the recorder is ready
+// (or as soon as possible on the grid of a resumed session).
+void
+MainWindow::startSchedule() {
+    if(session.msecStart == 0) {
+        session.msecStart = pClock->msecNow() + msecInterval;
+        if(secTotTime > 0)
+            session.msecEnd = session.msecStart - msecInterval + qint64(secTotTime)*1000;
+        saveCheckpoint();
+    }
+    publishSchedule();
+    scheduleNextImage();
 }
 
+
+// Frame N is due at msecStart + N*msecInterval: the timer is rearmed
+// on this grid every time so that the delays never accumulate.
+void
+MainWindow::scheduleNextImage() {
+    qint64 now = pClock->msecNow();
+    if(now > session.msecStart) {// Skip the slots we missed
+        int currentSlot = int((now-session.msecStart)/msecInterval);
+        if(currentSlot > session.nextFrame) {
+            stats.nMissedSlots += currentSlot - session.nextFrame;
+            session.nextFrame = currentSlot;
+        }
+    }
+    qint64 msecDue = session.msecStart + qint64(session.nextFrame)*msecInterval;
+    if((session.msecEnd != 0) && (msecDue >= session.msecEnd)) {
+        if(bSimulatedCamera)// raspistill/raspivid stop by themselves
+            on_stopButton_clicked();
+        return;
+    }
+    pIntervalTimer->start(int(qMax(qint64(0), msecDue-now)));
+}
+
+
+// A new interval while recording: the next frame is still taken when it
+// is due, the following ones on a grid anchored there (the frames keep
+// their numbers). The end of the session does not move.
+void
+MainWindow::changeInterval(int msecNewInterval) {
+    if(msecNewInterval == session.msecInterval)
+        return;
+    qint64 msecNewStart = 0;// Not yet started: the grid starts with the recorder
+    if(session.msecStart != 0) {
+        qint64 msecNext = session.msecStart + qint64(session.nextFrame)*session.msecInterval;
+        msecNewStart = msecNext - qint64(session.nextFrame)*msecNewInterval;
+    }
+    moveGrid(msecNewStart, msecNewInterval);
+}
+
+
+// Frame N is now due at msecNewStart + N*msecNewInterval
+bool
+MainWindow::moveGrid(qint64 msecNewStart, int msecNewInterval) {
+    // The settings may be continuous while the session is not
+    int msecMin = Config::minInterval(session.bContinuous);
+    if(msecNewInterval < msecMin) {
+        pUi->statusBar->showMessage(QString("Interval below %1 ms: kept %2 ms until the end of the session")
+                                    .arg(msecMin)
+                                    .arg(session.msecInterval));
+        return false;
+    }
+    int oldStreamFps = streamFps();
+    session.msecStart    = msecNewStart;
+    session.msecInterval = msecNewInterval;
+    msecInterval         = msecNewInterval;
+    saveCheckpoint();
+    publishSchedule();
+    if(pConfig->value(Config::HeartbeatTimeout) <= 0)
+        pSupervisor->setHeartbeatTimeout(HEARTBEAT_INTERVALS*msecInterval);
+    // A slower stream still gives two frames per interval, a faster one
+    // needs a new command line
+    if(bContinuous && (streamFps() > oldStreamFps))
+        pSupervisor->restart();
+    if(pIntervalTimer->isActive())
+        scheduleNextImage();
+    return true;
+}
+
+
+void
+MainWindow::saveCheckpoint() {
+    if(!session.bRunning)
+        return;
+    if(!pCheckpoint->save(session))
+        pUi->statusBar->showMessage(QString("Unable to save the session checkpoint"), 2000);
+}
+
+
+//////////////////////////////////////////////////////////////
+/// Multi-node synchronization <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+// SyncMode=leader   : SyncPort is where the followers find us
+// SyncMode=follower : SyncLeader=<host>:<port>
+void
+MainWindow::initSync() {
+    msecLeaderStart = 0;
+    QString sMode = pConfig->value(Config::SyncMode);
+    QString sNode = pConfig->value(Config::NodeName);
+    if(sMode == QString("leader")) {
+        pSyncNode = new SyncNode(SyncNode::Leader, sNode, this);
+        if(!pSyncNode->listen(quint16(pConfig->value(Config::SyncPort))))
+            pUi->statusBar->showMessage(QString("Unable to start the sync leader"));
+        publishSchedule();
+    }
+    else if(sMode == QString("follower")) {
+        QStringList leader = pConfig->value(Config::SyncLeader).split(':');
+        pSyncNode = new SyncNode(SyncNode::Follower, sNode, this);
+        connect(pSyncNode,
+                SIGNAL(scheduleReceived(SharedSchedule)),
+                this,
+                SLOT(onSyncSchedule(SharedSchedule)));
+        connect(pSyncNode,
+                SIGNAL(offsetChanged(qint64)),
+                this,
+                SLOT(onSyncOffsetChanged(qint64)));
+        quint16 port = quint16(leader.size() > 1 ? leader[1].toUInt() : SYNC_PORT);
+        QHostAddress leaderAddress = resolveLeader(leader[0].trimmed());
+        if(leaderAddress.isNull())
+            pUi->statusBar->showMessage(QString("Unknown sync leader: %1").arg(leader[0]));
+        else if(!pSyncNode->follow(leaderAddress, port))
+            pUi->statusBar->showMessage(QString("Unable to reach the sync leader"));
+        pUi->startButton->setDisabled(true);// The leader starts the followers
+    }
+}
+
+
+// The leader is a name or an address: our socket speaks IPv4 only.
+// Blocks on the name lookup, but only once, at startup.
+QHostAddress
+MainWindow::resolveLeader(const QString& sHost) const {
+    QList<QHostAddress> addresses = QHostInfo::fromName(sHost).addresses();
+    for(int i=0; i<addresses.size(); i++) {
+        if(addresses[i].protocol() == QAbstractSocket::IPv4Protocol)
+            return addresses[i];
+    }
+    return QHostAddress();
+}
+
+
+bool
+MainWindow::isFollower() const {
+    return pSyncNode && (pSyncNode->role() == SyncNode::Follower);
+}
+
+
+void
+MainWindow::publishSchedule() {
+    if(!pSyncNode || (pSyncNode->role() != SyncNode::Leader))
+        return;
+    SharedSchedule schedule;
+    schedule.sSessionId   = session.sSessionId;
+    schedule.msecStart    = session.msecStart;
+    schedule.msecInterval = session.msecInterval;
+    schedule.secTotTime   = session.secTotTime;
+    schedule.bRunning     = session.bRunning && (session.msecStart != 0);
+    pSyncNode->setSchedule(schedule);
+}
+
+
+// The followers start, and stop, with the leader
+void
+MainWindow::onSyncSchedule(const SharedSchedule& schedule) {
+    if(schedule.sSessionId == session.sSessionId) {
+        msecLeaderStart = schedule.msecStart;
+        if(!schedule.bRunning && session.bRunning)
+            on_stopButton_clicked();
+        else if(session.bRunning && (schedule.msecInterval != session.msecInterval)) {
+            // The leader moved its grid: so do we
+            if(moveGrid(pSyncNode->toLocalMsec(msecLeaderStart), schedule.msecInterval))
+                pConfig->setValue(Config::Interval, msecInterval);
+        }
+        return;
+    }
+    if(!schedule.bRunning)
+        return;
+    if(session.bRunning) {// The leader moved on: so do we
+        on_stopButton_clicked();
+        return;
+    }
+    if(pSupervisor->isRunning())// Still stopping: next time
+        return;
+    // Through the store, as if typed in: members and UI follow
+    QVariantMap settings;
+    settings[Config::Interval.sName]  = schedule.msecInterval;
+    settings[Config::TotalTime.sName] = schedule.secTotTime;
+    QString sError;
+    if(!pConfig->setValues(settings, &sError) || !checkValues())
+    {
+        pUi->statusBar->showMessage(QString("Unable to follow the leader: %1")
+                                    .arg(sError.isEmpty() ? QString("Check Values !") : sError));
+        return;
+    }
+    msecLeaderStart      = schedule.msecStart;
+    session.sSessionId   = schedule.sSessionId;
+    session.msecStart    = pSyncNode->toLocalMsec(msecLeaderStart);
+    session.msecInterval = msecInterval;
+    session.secTotTime   = secTotTime;
+    session.msecEnd      = 0;
+    if(secTotTime > 0)
+        session.msecEnd  = session.msecStart - msecInterval + qint64(secTotTime)*1000;
+    session.nCaptured    = 0;
+    session.nextFrame    = 0;
+    session.sBaseDir     = sBaseDir;
+    session.sOutFileName = sOutFileName;
+    session.bContinuous  = bContinuous;
+    session.bRunning     = true;
+    startSession();
+}
+
+
+// The grid follows the leader clock
+void
+MainWindow::onSyncOffsetChanged(qint64 usecOffset) {
+    Q_UNUSED(usecOffset)
+    if(!session.bRunning || (msecLeaderStart == 0))
+        return;
+    qint64 msecShift = pSyncNode->toLocalMsec(msecLeaderStart) - session.msecStart;
+    session.msecStart += msecShift;
+    if(session.msecEnd != 0)
+        session.msecEnd += msecShift;
+    if(pIntervalTimer->isActive())
+        scheduleNextImage();
+}
+
+
+//////////////////////////////////////////////////////////////
+/// Frame capture and processing <<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+// Taken when the frame is triggered
+FrameMetadata
+MainWindow::frameMetadata(int frameNum) {
+    FrameMetadata metadata;
+    metadata.sSessionId     = session.sSessionId;
+    metadata.frameNum       = frameNum;
+    metadata.msecScheduled  = session.msecStart + qint64(frameNum)*msecInterval;
+    metadata.msecTriggered  = pClock->msecNow();
+    metadata.bLampOn        = bLampOn;
+    metadata.panPulseWidth  = pSetupDlg->panPulseWidth();
+    metadata.tiltPulseWidth = pSetupDlg->tiltPulseWidth();
+    return metadata;
+}
+
+
+// A frame that nobody is waiting for (i.e. late, from a recorder given up
+// for lost) would take the number of the next trigger and be overwritten
+// by the real one: it is dropped instead.
+void
+MainWindow::onFrameCaptured(FrameBuffer* pFrame) {
+    if(pendingFrames.isEmpty()) {
+        qWarning() << "Dropped a frame that was not triggered";
+        pFramePool->release(pFrame);
+        return;
+    }
+    FrameMetadata metadata = pendingFrames.dequeue();
+    pFrame->frameNum = metadata.frameNum;
+    session.nCaptured++;
+    pSupervisor->frameArrived();
+    emit frameToProcess(pFrame, metadata);// The pipeline gives the buffer back to the pool
+}
+
+
+void
+MainWindow::onNewImageFile(const QString& sFileName) {
+    if(pendingFrames.isEmpty()) {
+        qWarning() << "Dropped a frame that was not triggered:" << sFileName;
+        QFile::remove(sFileName);// From the staging folder
+        return;
+    }
+    FrameMetadata metadata = pendingFrames.dequeue();
+    session.nCaptured++;
+    pSupervisor->frameArrived();
+    emit fileToProcess(metadata, sFileName);
+}
+
+
+void
+MainWindow::onPipelineError(const QString& sMessage) {
+    pUi->statusBar->showMessage(sMessage, 2000);
+}
+
+
+// The stills are shown once saved (raspistill has no stream)
+void
+MainWindow::onFrameProcessed(int frameNum, const QString& sFileName) {
+    Q_UNUSED(frameNum)
+    if(!bContinuous && !sFileName.isEmpty())
+        pPreview->showFile(sFileName);
+}
+
+
+void
+MainWindow::onGovernorLevel(int level, const QString& sReason) {
+    static const char* levelNames[] = { "normal", "reduced", "minimal" };
+    pUi->statusBar->showMessage(QString("Background work %1: %2")
+                                .arg(levelNames[qBound(0, level, 2)])
+                                .arg(sReason), 5000);
+}
+
+
+// The limits of the background work, the preview, the output profiles
+// and the interval (on a new grid) follow at once, the other session
+// parameters only between sessions.
+void
+MainWindow::onConfigChanged(const QString& sKey, const QVariant& value) {
+    Q_UNUSED(value)
+    if(sKey == Config::PreviewFps.sName) {
+        previewFps = pConfig->value(Config::PreviewFps);
+        pPreview->setMaxFps(previewFps);
+    }
+    else if((sKey == Config::ThermalWarm.sName) ||
+            (sKey == Config::ThermalHot.sName) ||
+            (sKey == Config::LoadPerCore.sName) ||
+            (sKey == Config::LatencyBudget.sName))
+    {
+        loadGovernorSettings();
+        pGovernor->setThresholds(thermalWarm, thermalHot, loadPerCore, latencyBudget);
+    }
+    else if(sKey == Config::OutputProfiles.sName) {
+        outputProfiles = OutputProfile::restore(pConfig->value(Config::OutputProfiles));
+        if(isRecording())// From the next frame on
+            pPipeline->setSession(session.sBaseDir, sessionFileName(), outputProfiles);
+    }
+    else if((sKey == Config::Interval.sName) && session.bRunning) {
+        if(!isFollower())// The leader moves the grid of the followers
+            changeInterval(pConfig->value(Config::Interval));
+    }
+    else if(!isRecording()) {
+        loadSessionSettings();
+        showSessionSettings();
+    }
+}
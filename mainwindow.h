@@ -4,9 +4,22 @@
 
 #include <QMainWindow>
 #include <QProcess>
-#include <QTimer>
-#include <sys/types.h>
+#include <QThread>
+#include <QQueue>
 #include "setupdialog.h"
+#include "framebufferpool.h"
+#include "streamcapture.h"
+#include "framepipeline.h"
+#include "directorywatcher.h"
+#include "sessioncheckpoint.h"
+#include "recordersupervisor.h"
+#include "framepacker.h"
+#include "syncnode.h"
+#include "clock.h"
+#include "gpio.h"
+#include "resourcegovernor.h"
+#include "previewrenderer.h"
+#include "configstore.h"
 
 
 namespace Ui {
@@ -14,26 +27,82 @@ class MainWindow;
 }
 
 
+// How well the schedule has been kept in the current session
+struct ScheduleStats
+{
+    int    nTriggers;
+    int    nMissedSlots;    // Skipped because we were late or the recorder was down
+    int    msecMaxLateness;
+    qint64 msecLatenessSum;
+};
+
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget *parent = nullptr);
+    MainWindow(Clock* pClock, Gpio* pGpio, ConfigStore* pConfig, QWidget *parent = nullptr);
+    ~MainWindow();
+
+    void startRecording();
+    void stopRecording();
+    bool isRecording() const;
+    const SessionState&  sessionState() const  { return session; }
+    const ScheduleStats& scheduleStats() const { return stats; }
+    int  recorderIncidents() const { return pSupervisor->incidents(); }
+    const GovernorStats& governorStats() const { return pGovernor->stats(); }
+    uint lampPin() const { return gpioLEDpin; }
 
 protected:
-    void moveEvent(QMoveEvent *event) Q_DECL_OVERRIDE;
     void restoreSettings();
+    void loadSessionSettings();
+    void loadGovernorSettings();
+    void showSessionSettings();
+    void storeSessionSettings();
     void closeEvent(QCloseEvent *event) Q_DECL_OVERRIDE;
     void switchLampOn();
     void switchLampOff();
     bool checkValues();
     bool gpioInit();
+    int  streamFps();
+    QString recorderCommand();
+    QString previewCommand();
+    QString stagingDir();
+    FrameMetadata frameMetadata(int frameNum);
+    Recorder* createRecorder(QObject* pParent);
+    Recorder* createPreviewRecorder(QObject* pParent);
+    QString sessionFileName() const;
+    void startSession();
+    void startSchedule();
+    void scheduleNextImage();
+    void changeInterval(int msecNewInterval);
+    bool moveGrid(qint64 msecNewStart, int msecNewInterval);
+    void saveCheckpoint();
+    void initSync();
+    void publishSchedule();
+    QHostAddress resolveLeader(const QString& sHost) const;
+    bool isFollower() const;
+    int  msecRemaining();
+
+signals:
+    void frameToProcess(FrameBuffer* pFrame, const FrameMetadata& metadata);
+    void fileToProcess(const FrameMetadata& metadata, const QString& sFileName);
 
 public slots:
-    void onImageRecorderClosed(int exitCode, QProcess::ExitStatus exitStatus);
-    void onImageRecorderStarted();
-    void onImageRecorderError(QProcess::ProcessError error);
+    void onRecorderReady(Recorder* pRecorder);
+    void onRecorderLost(int nOutstanding);
+    void onRecorderRecovered(qint64 msecDowntime, int nLostFrames);
+    void onRecorderFinished(int exitCode);
+    void onFrameCaptured(FrameBuffer* pFrame);
+    void onNewImageFile(const QString& sFileName);
+    void onSyncSchedule(const SharedSchedule& schedule);
+    void onSyncOffsetChanged(qint64 usecOffset);
+    void onPipelineError(const QString& sMessage);
+    void onFrameProcessed(int frameNum, const QString& sFileName);
+    void onGovernorLevel(int level, const QString& sReason);
+    void onConfigChanged(const QString& sKey, const QVariant& value);
+    void resumeSession();
 
 private slots:
     void on_startButton_clicked();
@@ -47,27 +116,42 @@ private slots:
     void on_pathEdit_editingFinished();
     void on_nameEdit_textChanged(const QString &arg1);
     void on_setupButton_clicked();
+    void on_continuousBox_toggled(bool checked);
 
 private:
     Ui::MainWindow* pUi;
-    QProcess*       pImageRecorder;
+    RecorderSupervisor* pSupervisor;
     setupDialog*    pSetupDlg;
-
-    pid_t pid;
+    FrameBufferPool* pFramePool;
+    StreamCapture*  pStreamCapture;
+    FramePipeline*  pPipeline;
+    FramePacker*    pPacker;
+    DirectoryWatcher* pFrameWatcher;
+    SessionCheckpoint* pCheckpoint;
+    SyncNode*       pSyncNode;       // Q_NULLPTR when running alone
+    ResourceGovernor* pGovernor;
+    PreviewRenderer* pPreview;
 
     uint   gpioLEDpin;
-    uint   panPin;
-    uint   tiltPin;
-    double cameraPanAngle;
-    double cameraTiltAngle;
-    uint   PWMfrequency;     // in Hz
-    double pulseWidthAt_90;  // in us
-    double pulseWidthAt90;   // in us
-    int    gpioHostHandle;
+    Clock* pClock;
+    Gpio*  pGpio;
+    ConfigStore* pConfig;
+    bool   bLampOn;
 
     int    msecInterval;
     int    secTotTime;
-    int    imageNum;
+    int    checkpointFrames; // Save the session state every N frames
+    bool   bContinuous;      // Grab the frames from the video port stream
+    bool   bSimulatedCamera; // Use the simulated camera instead of raspistill/raspivid
+    bool   bPackFrames;      // Roll the frames into chunk archives
+    int    chunkMBytes;      // Size of a chunk archive
+    int    packerKBytes;     // Packer write rate (KB/s)
+    QString sSysfsRoot;      // Where the governor finds sys/ and proc/
+    double thermalWarm;      // in °C: background work reduced
+    double thermalHot;       // in °C: background work reduced to the minimum
+    double loadPerCore;      // Load average that reduces the background work
+    int    latencyBudget;    // Capture lateness that reduces the background work (ms)
+    int    previewFps;       // Preview frames decoded per second, at most
 
     QString sNormalStyle;
     QString sErrorStyle;
@@ -78,11 +162,14 @@ private:
     QString sBaseDir;
     QString sOutFileName;
 
-    QTimer intervalTimer;
-
-    QPoint dialogPos;
-    QPoint videoPos;
-    QSize videoSize;
+    ClockTimer* pIntervalTimer;
+    QThread pipelineThread;
+    QThread packerThread;
+    QVector<OutputProfile> outputProfiles;
+    SessionState session;
+    ScheduleStats stats;
+    QQueue<FrameMetadata> pendingFrames; // Triggered but not yet arrived
+    qint64 msecLeaderStart;      // Schedule origin on the leader clock
 };
 
 #endif // MAINWINDOW_H
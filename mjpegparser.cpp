@@ -0,0 +1,138 @@
+#include "mjpegparser.h"
+#include <string.h>
+
+
+// JPEG markers we have to care about
+#define M_SOI  0xD8
+#define M_EOI  0xD9
+#define M_SOS  0xDA
+#define M_TEM  0x01
+#define M_RST0 0xD0
+#define M_RST7 0xD7
+
+
+static inline bool
+isStandalone(int code) {
+    return (code == M_TEM) || (code >= M_RST0 && code <= M_RST7);
+}
+
+
+MjpegParser::MjpegParser() {
+    reset();
+}
+
+
+void
+MjpegParser::reset() {
+    state       = SeekSoi;
+    iFrameStart = -1;
+    iMarker     = 0;
+    iToSkip     = 0;
+}
+
+
+int
+MjpegParser::scan(const unsigned char* data, int from, int to) {
+    int i = from;
+    while(i < to) {
+        switch(state) {
+        case SeekSoi: {
+            const void* p = memchr(data+i, 0xFF, size_t(to-i));
+            if(!p)
+                return -1;
+            i = int(static_cast<const unsigned char*>(p)-data) + 1;
+            state = SeekSoiFF;
+            break;
+        }
+        case SeekSoiFF:
+            if(data[i] == M_SOI) {
+                iFrameStart = i-1;
+                state = ExpectFF;
+            }
+            else if(data[i] != 0xFF)
+                state = SeekSoi;
+            i++;
+            break;
+        case ExpectFF:
+            if(data[i] != 0xFF) {// Corrupted frame: look for the next SOI
+                iFrameStart = -1;
+                state = SeekSoi;
+                break;
+            }
+            state = ExpectCode;
+            i++;
+            break;
+        case ExpectCode: {
+            int code = data[i++];
+            if(code == 0xFF) // Fill byte
+                break;
+            if(code == M_EOI) {
+                state = SeekSoi;
+                return i;
+            }
+            if(code == M_SOI) {// Truncated frame followed by a new one
+                iFrameStart = i-2;
+                state = ExpectFF;
+                break;
+            }
+            if(isStandalone(code)) {
+                state = ExpectFF;
+                break;
+            }
+            iMarker = code;
+            state = LengthHi;
+            break;
+        }
+        case LengthHi:
+            iToSkip = data[i++] << 8;
+            state = LengthLo;
+            break;
+        case LengthLo:
+            iToSkip = (iToSkip | data[i++]) - 2;
+            if(iToSkip < 0) {
+                iFrameStart = -1;
+                state = SeekSoi;
+            }
+            else if(iToSkip == 0)
+                state = (iMarker == M_SOS) ? Entropy : ExpectFF;
+            else
+                state = SkipSegment;
+            break;
+        case SkipSegment: {
+            int n = to-i < iToSkip ? to-i : iToSkip;
+            i += n;
+            iToSkip -= n;
+            if(iToSkip == 0)
+                state = (iMarker == M_SOS) ? Entropy : ExpectFF;
+            break;
+        }
+        case Entropy: {
+            const void* p = memchr(data+i, 0xFF, size_t(to-i));
+            if(!p)
+                return -1;
+            i = int(static_cast<const unsigned char*>(p)-data) + 1;
+            state = EntropyFF;
+            break;
+        }
+        case EntropyFF: {
+            int code = data[i++];
+            if(code == 0x00 || isStandalone(code))// Stuffed byte or Restart
+                state = Entropy;
+            else if(code == M_EOI) {
+                state = SeekSoi;
+                return i;
+            }
+            else if(code == M_SOI) {// Truncated frame followed by a new one
+                iFrameStart = i-2;
+                state = ExpectFF;
+            }
+            else if(code != 0xFF) {// A new segment (i.e. progressive JPEG)
+                iMarker = code;
+                state = LengthHi;
+            }
+            break;
+        }
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,44 @@
+#ifndef MJPEGPARSER_H
+#define MJPEGPARSER_H
+
+
+// Incremental JPEG frame boundary finder for an MJPEG byte stream.
+//
+// The parser never copies data: it only walks the bytes already stored
+// in the caller buffer and reports where a frame starts and ends.
+// Marker segments are skipped by their declared length, so an EOI that
+// appears inside an embedded thumbnail is not mistaken for the frame end,
+// and the entropy coded data is scanned with memchr() for 0xFF bytes only.
+class MjpegParser
+{
+public:
+    MjpegParser();
+
+    void reset();
+    // Scans data[from, to). Returns the offset just past the EOI marker
+    // when a whole frame has been found (see frameStart()), -1 otherwise.
+    // The buffer may be moved between calls as long as the offsets of the
+    // bytes already scanned are preserved.
+    int scan(const unsigned char* data, int from, int to);
+    int frameStart() const { return iFrameStart; }
+
+private:
+    enum State {
+        SeekSoi,
+        SeekSoiFF,
+        ExpectFF,
+        ExpectCode,
+        LengthHi,
+        LengthLo,
+        SkipSegment,
+        Entropy,
+        EntropyFF
+    };
+
+    State state;
+    int   iFrameStart;
+    int   iMarker;
+    int   iToSkip;
+};
+
+#endif // MJPEGPARSER_H
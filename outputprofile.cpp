@@ -0,0 +1,28 @@
+#include "outputprofile.h"
+
+
+#define DEFAULT_QUALITY 90
+
+
+QVector<OutputProfile>
+OutputProfile::restore(const QVariantList& settings) {
+    QVector<OutputProfile> profiles;
+    for(int i=0; i<settings.size(); i++) {
+        QVariantMap values = settings[i].toMap();
+        OutputProfile profile;
+        profile.sName   = values.value("Name").toString();
+        profile.size    = QSize(values.value("Width",  0).toInt(),
+                                values.value("Height", 0).toInt());
+        profile.roi     = values.value("Roi", QRect()).toRect();
+        profile.quality = values.value("Quality", DEFAULT_QUALITY).toInt();
+        if(!profile.sName.isEmpty())
+            profiles.append(profile);
+    }
+    if(profiles.isEmpty()) {// Just the full frame, as it always has been
+        OutputProfile full;
+        full.sName   = QString("full");
+        full.quality = DEFAULT_QUALITY;
+        profiles.append(full);
+    }
+    return profiles;
+}
@@ -0,0 +1,37 @@
+#ifndef OUTPUTPROFILE_H
+#define OUTPUTPROFILE_H
+
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <QVariant>
+
+
+// One of the images produced for every captured frame.
+// The profiles are stored in the "OutputProfiles" settings array:
+//
+//   OutputProfiles/1/Name=full
+//   OutputProfiles/2/Name=web
+//   OutputProfiles/2/Width=1280
+//   OutputProfiles/2/Height=720
+//   OutputProfiles/3/Name=nest
+//   OutputProfiles/3/Roi=@Rect(800 300 640 480)
+//
+// A profile without size and Roi is the frame exactly as delivered by the
+// camera and it is written without being decoded. Every other profile
+// ends up in a sub folder, named after the profile, of the output path.
+struct OutputProfile
+{
+    QString sName;
+    QSize   size;    // Fit into this size (keeping the aspect ratio). Empty: no scaling
+    QRect   roi;     // Region of the frame to keep. Null: the whole frame
+    int     quality; // JPEG quality
+
+    bool isPassThrough() const { return size.isEmpty() && roi.isNull(); }
+
+    // From the "OutputProfiles" setting (one QVariantMap per profile)
+    static QVector<OutputProfile> restore(const QVariantList& settings);
+};
+
+#endif // OUTPUTPROFILE_H
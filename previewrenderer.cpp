@@ -0,0 +1,279 @@
+#include "previewrenderer.h"
+#include <QWidget>
+#include <QPainter>
+#include <QEvent>
+#include <QFile>
+#include <QMutexLocker>
+#include <string.h>
+
+
+#define PREVIEW_FPS     10
+#define MAX_DENOMINATOR 8     // libjpeg scales by 1/2, 1/4 and 1/8 while decoding
+
+
+//////////////////////////////////////////////////////////////
+/// Decoder (its own thread) <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+PreviewDecoder::PreviewDecoder(const QSize& targetSize, int jpegBytes)
+    : previewSize(targetSize)
+    , buffer(this)// Moves with us to the decoder thread
+    , iPendingSlot(0)
+    , bPending(false)
+    , bBusy(false)
+    , bMeasure(false)
+    , iShown(-1)
+    , iReady(-1)
+    , nDropped(0)
+{
+    for(int i=0; i<2; i++)
+        jpegSlots[i].reserve(jpegBytes);
+}
+
+
+bool
+PreviewDecoder::submit(const char* pData, int size) {
+    QMutexLocker locker(&mutex);
+    if(bPending)// Not decoded yet: now stale
+        nDropped++;
+    QByteArray& slot = jpegSlots[iPendingSlot];
+    slot.resize(size);// Within the reserved capacity: no allocation
+    memcpy(slot.data(), pData, size_t(size));
+    fileSlots[iPendingSlot].clear();
+    bPending = true;
+    if(bBusy)
+        return false;
+    bBusy = true;
+    return true;
+}
+
+
+bool
+PreviewDecoder::submitFile(const QString& sFileName) {
+    QMutexLocker locker(&mutex);
+    if(bPending)
+        nDropped++;
+    jpegSlots[iPendingSlot].resize(0);
+    fileSlots[iPendingSlot] = sFileName;
+    bPending = true;
+    if(bBusy)
+        return false;
+    bBusy = true;
+    return true;
+}
+
+
+// The pending slot becomes the decoding one and vice versa:
+// the GUI thread can fill the other while we decode.
+void
+PreviewDecoder::decode() {
+    forever {
+        int  iSlot;
+        int  iTarget = 0;
+        bool bMeters;
+        {
+            QMutexLocker locker(&mutex);
+            if(!bPending) {
+                bBusy = false;
+                return;
+            }
+            iSlot        = iPendingSlot;
+            iPendingSlot = 1 - iPendingSlot;
+            bPending     = false;
+            bMeters      = bMeasure;
+            while((iTarget == iShown) || (iTarget == iReady))
+                iTarget++;
+        }
+        if(!fileSlots[iSlot].isEmpty() && !loadFile(iSlot))
+            continue;
+        buffer.close();
+        buffer.setBuffer(&jpegSlots[iSlot]);
+        buffer.open(QIODevice::ReadOnly);
+        reader.setDevice(&buffer);
+        int denominator = scaleDenominator(reader.size());
+        QSize fullSize = reader.size();
+        // Exactly what libjpeg produces: no further scaling
+        reader.setScaledSize(QSize((fullSize.width()  + denominator-1)/denominator,
+                                   (fullSize.height() + denominator-1)/denominator));
+        // Into the existing image if size and format match
+        if(!reader.read(&images[iTarget]))
+            continue;
+        {
+            QMutexLocker locker(&mutex);
+            if(iReady >= 0)// Never shown
+                nDropped++;
+            iReady = iTarget;
+        }
+        emit frameReady();
+        // The GUI thread may be painting it: both only read
+        if(bMeters && meter.measure(images[iTarget], &meters))
+            emit metersReady(meters);
+    }
+}
+
+
+// The largest libjpeg reduction that still covers the preview
+int
+PreviewDecoder::scaleDenominator(const QSize& frameSize) {
+    int denominator = 1;
+    while((denominator < MAX_DENOMINATOR) &&
+          (frameSize.width()/(2*denominator)  >= previewSize.width()) &&
+          (frameSize.height()/(2*denominator) >= previewSize.height()))
+    {
+        denominator *= 2;
+    }
+    return denominator;
+}
+
+
+// Into the slot buffer: it grows only for a frame larger than any before
+bool
+PreviewDecoder::loadFile(int iSlot) {
+    QFile file(fileSlots[iSlot]);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+    QByteArray& slot = jpegSlots[iSlot];
+    slot.resize(int(file.size()));
+    return file.read(slot.data(), slot.size()) == slot.size();
+}
+
+
+const QImage*
+PreviewDecoder::acquireLatest() {
+    QMutexLocker locker(&mutex);
+    if(iReady >= 0) {
+        iShown = iReady;
+        iReady = -1;
+    }
+    return (iShown >= 0) ? &images[iShown] : Q_NULLPTR;
+}
+
+
+void
+PreviewDecoder::clear() {
+    QMutexLocker locker(&mutex);
+    iShown = -1;
+    iReady = -1;
+}
+
+
+int
+PreviewDecoder::droppedFrames() {
+    QMutexLocker locker(&mutex);
+    return nDropped;
+}
+
+
+void
+PreviewDecoder::setMetersEnabled(bool bEnable) {
+    QMutexLocker locker(&mutex);
+    bMeasure = bEnable;
+}
+
+
+//////////////////////////////////////////////////////////////
+/// Renderer (GUI thread) <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+PreviewRenderer::PreviewRenderer(QWidget* pTarget, Clock* pClock, QObject *parent)
+    : QObject(parent)
+    , pWidget(pTarget)
+    , pClock(pClock)
+    , msecMinInterval(1000/PREVIEW_FPS)
+    , msecLastFrame(0)
+    , nDropped(0)
+{
+    qRegisterMetaType<FrameMeters>("FrameMeters");
+    pDecoder = new PreviewDecoder(pWidget->size(), 1024*1024);
+    pDecoder->moveToThread(&decoderThread);
+    connect(&decoderThread,
+            SIGNAL(finished()),
+            pDecoder,
+            SLOT(deleteLater()));
+    connect(pDecoder,
+            SIGNAL(frameReady()),
+            this,
+            SLOT(onFrameReady()));
+    connect(pDecoder,
+            SIGNAL(metersReady(FrameMeters)),
+            this,
+            SIGNAL(metersReady(FrameMeters)));
+    decoderThread.start();
+    pWidget->installEventFilter(this);
+}
+
+
+PreviewRenderer::~PreviewRenderer() {
+    if(pWidget)
+        pWidget->removeEventFilter(this);
+    decoderThread.quit();
+    decoderThread.wait();
+}
+
+
+void
+PreviewRenderer::setMaxFps(int fps) {
+    msecMinInterval = 1000/qMax(1, fps);
+}
+
+
+void
+PreviewRenderer::clear() {
+    pDecoder->clear();
+    pWidget->update();
+}
+
+
+bool
+PreviewRenderer::isTooEarly() {
+    qint64 msecNow = pClock->msecNow();
+    if(msecNow - msecLastFrame < msecMinInterval) {
+        nDropped++;
+        return true;
+    }
+    msecLastFrame = msecNow;
+    return false;
+}
+
+
+void
+PreviewRenderer::showFrame(const char* pData, int size) {
+    if(isTooEarly())
+        return;
+    if(pDecoder->submit(pData, size))
+        QMetaObject::invokeMethod(pDecoder, "decode", Qt::QueuedConnection);
+}
+
+
+void
+PreviewRenderer::showFile(const QString& sFileName) {
+    if(isTooEarly())
+        return;
+    if(pDecoder->submitFile(sFileName))
+        QMetaObject::invokeMethod(pDecoder, "decode", Qt::QueuedConnection);
+}
+
+
+void
+PreviewRenderer::onFrameReady() {
+    if(pWidget)
+        pWidget->update();
+}
+
+
+// We paint instead of the widget: the frame, fit and centered, on black
+bool
+PreviewRenderer::eventFilter(QObject* pObject, QEvent* pEvent) {
+    if((pObject != pWidget.data()) || (pEvent->type() != QEvent::Paint))
+        return QObject::eventFilter(pObject, pEvent);
+    QPainter painter(pWidget);
+    painter.fillRect(pWidget->rect(), Qt::black);
+    const QImage* pImage = pDecoder->acquireLatest();
+    if(pImage && !pImage->isNull()) {
+        QSize size = pImage->size().scaled(pWidget->size(), Qt::KeepAspectRatio);
+        QRect target(QPoint((pWidget->width()-size.width())/2,
+                            (pWidget->height()-size.height())/2),
+                     size);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        painter.drawImage(target, *pImage);
+    }
+    return true;
+}
@@ -0,0 +1,112 @@
+#ifndef PREVIEWRENDERER_H
+#define PREVIEWRENDERER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QImage>
+#include <QBuffer>
+#include <QImageReader>
+#include <QPointer>
+#include "clock.h"
+#include "framemeters.h"
+
+
+// Decodes the preview frames in its own thread, always the newest one.
+// There are two JPEG slots (the one being decoded and the pending one)
+// and three images (the shown one, the newest decoded and the one being
+// decoded into): they are all allocated once and reused, so a frame
+// costs no allocation of JPEG or pixel memory. A frame replaced before
+// being decoded, or before being shown, is simply dropped.
+// When enabled, the FrameMeters of every decoded frame are computed here
+// too, away from the GUI thread that drives the servos.
+class PreviewDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    PreviewDecoder(const QSize& targetSize, int jpegBytes);
+
+    bool submit(const char* pData, int size);   // true if decode() has to be invoked
+    bool submitFile(const QString& sFileName);  // Read by the decoder thread
+    const QImage* acquireLatest();              // Valid until the next call (GUI only)
+    void clear();
+    int  droppedFrames();
+    void setMetersEnabled(bool bEnable);
+
+public slots:
+    void decode();
+
+signals:
+    void frameReady();
+    void metersReady(const FrameMeters& meters);
+
+protected:
+    int  scaleDenominator(const QSize& frameSize);
+    bool loadFile(int iSlot);
+
+private:
+    QMutex       mutex;
+    QSize        previewSize;
+    QByteArray   jpegSlots[2];
+    QString      fileSlots[2];
+    QImage       images[3];
+    QBuffer      buffer;
+    QImageReader reader;
+    FrameMeter   meter;
+    FrameMeters  meters;
+    int          iPendingSlot;
+    bool         bPending;
+    bool         bBusy;
+    bool         bMeasure;     // Meters of every decoded frame
+    int          iShown;       // -1 = Nothing to show
+    int          iReady;       // -1 = Nothing new
+    int          nDropped;
+};
+
+
+// Shows the camera frames in a widget (i.e. a QLabel of the .ui) by
+// painting over it, instead of the raspistill overlay that ignores the
+// window it is supposed to be in.
+// At most maxFps frames per second are decoded, the others are dropped
+// before being even copied.
+class PreviewRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    PreviewRenderer(QWidget* pTarget, Clock* pClock, QObject *parent = nullptr);
+    ~PreviewRenderer();
+
+    void setMaxFps(int fps);
+    void setMetersEnabled(bool bEnable) { pDecoder->setMetersEnabled(bEnable); }
+    void clear();
+    int  droppedFrames() { return nDropped + pDecoder->droppedFrames(); }
+
+public slots:
+    // The data are copied before returning: connect with Qt::DirectConnection
+    void showFrame(const char* pData, int size);
+    void showFile(const QString& sFileName);
+
+signals:
+    // From the decoder thread, after the frame they measure is shown
+    void metersReady(const FrameMeters& meters);
+
+protected:
+    bool eventFilter(QObject* pObject, QEvent* pEvent) Q_DECL_OVERRIDE;
+    bool isTooEarly();
+
+private slots:
+    void onFrameReady();
+
+private:
+    QPointer<QWidget> pWidget;       // Usually deleted before us, with the .ui
+    Clock*            pClock;
+    PreviewDecoder*   pDecoder;
+    QThread           decoderThread;
+    int               msecMinInterval;
+    qint64            msecLastFrame;
+    int               nDropped;      // By the rate limit
+};
+
+#endif // PREVIEWRENDERER_H
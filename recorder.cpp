@@ -0,0 +1,320 @@
+#include "recorder.h"
+#include "simulatedmjpegsource.h"
+#include <signal.h>
+#include <QBuffer>
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QTimer>
+
+
+#define SIMULATED_EXPOSURE 150 // in ms
+#define KILL_DELAY         3000 // in ms: from SIGTERM to SIGKILL
+
+
+Recorder::Recorder(QObject *parent)
+    : QObject(parent)
+{
+}
+
+
+//////////////////////////////////////////////////////////////
+/// raspistill / raspivid <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+ProcessRecorder::ProcessRecorder(const QString& sCommand, bool bStream, QObject *parent)
+    : Recorder(parent)
+    , pProcess(Q_NULLPTR)
+    , sCommandLine(sCommand)
+    , bStreamOutput(bStream)
+    , pid(0)
+{
+}
+
+
+ProcessRecorder::~ProcessRecorder() {
+    terminateProcess();
+}
+
+
+void
+ProcessRecorder::start() {
+    pProcess = new QProcess(this);
+    connect(pProcess,
+            SIGNAL(finished(int, QProcess::ExitStatus)),
+            this,
+            SLOT(onFinished(int, QProcess::ExitStatus)));
+    connect(pProcess,
+            SIGNAL(errorOccurred(QProcess::ProcessError)),
+            this,
+            SLOT(onError(QProcess::ProcessError)));
+    connect(pProcess,
+            SIGNAL(started()),
+            this,
+            SLOT(onStarted()));
+    pProcess->start(sCommandLine);
+}
+
+
+void
+ProcessRecorder::stop() {
+    if(pid != 0)
+        ::kill(pid, SIGINT);
+}
+
+
+// No finished() signal will be emitted
+void
+ProcessRecorder::kill() {
+    if(!terminateProcess())
+        emit released();
+}
+
+
+// SIGTERM now and SIGKILL after KILL_DELAY, without waiting: we are
+// here because raspistill is hung, and the scheduler, the lamp and the
+// UI must go on meanwhile. The process is not ours anymore (we are
+// usually deleted next): it deletes itself once it is gone.
+// false if there was no process to wait for.
+bool
+ProcessRecorder::terminateProcess() {
+    if(!pProcess)
+        return false;
+    QProcess* pDying = pProcess;
+    pProcess = Q_NULLPTR;
+    pid = 0;
+    pDying->disconnect(this);
+    if(pDying->state() == QProcess::NotRunning) {
+        pDying->deleteLater();
+        return false;
+    }
+    pDying->setParent(Q_NULLPTR);
+    connect(pDying,
+            SIGNAL(finished(int, QProcess::ExitStatus)),
+            pDying,
+            SLOT(deleteLater()));
+    connect(pDying,
+            SIGNAL(finished(int, QProcess::ExitStatus)),
+            this,
+            SIGNAL(released()));
+    connect(pDying, &QProcess::errorOccurred, this, [this, pDying](QProcess::ProcessError error) {
+        if(error != QProcess::FailedToStart)// Else finished() follows
+            return;
+        pDying->deleteLater();
+        emit released();
+    });
+    pDying->terminate();
+    QTimer::singleShot(KILL_DELAY, pDying, SLOT(kill()));
+    return true;
+}
+
+
+bool
+ProcessRecorder::trigger() {
+    if(pid == 0)
+        return false;
+    if(bStreamOutput)// raspivid is not in signal mode: SIGUSR1 would kill it
+        return true;
+    return ::kill(pid, SIGUSR1) == 0;
+}
+
+
+bool
+ProcessRecorder::isReady() const {
+    return (pid != 0) && pProcess && (pProcess->state() == QProcess::Running);
+}
+
+
+QIODevice*
+ProcessRecorder::stream() {
+    return bStreamOutput ? pProcess : Q_NULLPTR;
+}
+
+
+void
+ProcessRecorder::onStarted() {
+    pid = pid_t(pProcess->processId());
+    if(pid != 0)
+        emit ready();
+}
+
+
+void
+ProcessRecorder::onFinished(int exitCode, QProcess::ExitStatus exitStatus) {
+    pid = 0;
+    emit finished(exitCode, exitStatus == QProcess::CrashExit);
+}
+
+
+void
+ProcessRecorder::onError(QProcess::ProcessError error) {
+    if(error == QProcess::FailedToStart)// No finished() will follow
+        emit finished(-1, true);
+}
+
+
+//////////////////////////////////////////////////////////////
+/// Simulated camera <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+//////////////////////////////////////////////////////////////
+SimulatedRecorder::SimulatedRecorder(const QString& sDirectory,
+                                     const QString& sPrefix,
+                                     int fps,
+                                     bool bStream,
+                                     Clock* pClock,
+                                     QObject *parent)
+    : Recorder(parent)
+    , sDir(sDirectory)
+    , sNamePrefix(sPrefix)
+    , iFps(fps)
+    , bStreamOutput(bStream)
+    , pClock(pClock)
+    , pSource(Q_NULLPTR)
+    , bReady(false)
+    , bStopRequested(false)
+    , startupMsec(1500)
+    , crashFrames(0)
+    , hangFrames(0)
+    , nFrames(0)
+    , nPendingShots(0)
+    , nWritten(0)
+{
+    pStartupTimer = pClock->createTimer(this);
+    pStartupTimer->setSingleShot(true);
+    connect(pStartupTimer,
+            SIGNAL(timeout()),
+            this,
+            SLOT(onStartupDone()));
+    pExposureTimer = pClock->createTimer(this);
+    pExposureTimer->setSingleShot(true);
+    connect(pExposureTimer,
+            SIGNAL(timeout()),
+            this,
+            SLOT(onExposureDone()));
+}
+
+
+void
+SimulatedRecorder::start() {
+    if(!bStreamOutput && cannedJpeg.isEmpty()) {
+        QImage image(1920, 1080, QImage::Format_RGB32);
+        image.fill(Qt::darkGray);
+        QPainter painter(&image);
+        painter.fillRect(760, 340, 400, 400, Qt::white);
+        painter.end();
+        QBuffer buffer(&cannedJpeg);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, "JPG", 90);
+    }
+    pStartupTimer->start(startupMsec);
+}
+
+
+void
+SimulatedRecorder::stop() {
+    if(nPendingShots > 0) {// Like raspistill, the shots in progress are completed
+        bStopRequested = true;
+        return;
+    }
+    halt();
+    QMetaObject::invokeMethod(this,
+                              "finished",
+                              Qt::QueuedConnection,
+                              Q_ARG(int, 130),
+                              Q_ARG(bool, false));
+}
+
+
+// No finished() signal will be emitted
+void
+SimulatedRecorder::kill() {
+    halt();
+    emit released();// Nothing to wait for
+}
+
+
+void
+SimulatedRecorder::halt() {
+    bReady = false;
+    bStopRequested = false;
+    pStartupTimer->stop();
+    pExposureTimer->stop();
+    nPendingShots = 0;
+    if(pSource) {
+        pSource->close();
+        pSource->deleteLater();
+        pSource = Q_NULLPTR;
+    }
+}
+
+
+void
+SimulatedRecorder::crash() {
+    if(!bReady)// Stopped in the meantime
+        return;
+    halt();
+    emit finished(139, true);// As killed by SIGSEGV
+}
+
+
+bool
+SimulatedRecorder::trigger() {
+    if(!bReady)
+        return false;
+    nFrames++;
+    if(crashFrames && (nFrames >= crashFrames)) {
+        QMetaObject::invokeMethod(this, "crash", Qt::QueuedConnection);
+        return true;
+    }
+    if(hangFrames && (nFrames >= hangFrames)) {// Alive but producing nothing
+        if(pSource)
+            pSource->close();
+        return true;
+    }
+    if(!bStreamOutput) {
+        nPendingShots++;
+        if(!pExposureTimer->isActive())
+            pExposureTimer->start(SIMULATED_EXPOSURE);
+    }
+    return true;
+}
+
+
+bool
+SimulatedRecorder::isReady() const {
+    return bReady;
+}
+
+
+QIODevice*
+SimulatedRecorder::stream() {
+    return pSource;
+}
+
+
+void
+SimulatedRecorder::onStartupDone() {
+    if(bStreamOutput)
+        pSource = new SimulatedMjpegSource(iFps, pClock, this);
+    bReady = true;
+    emit ready();
+}
+
+
+// Like raspistill: written to "name~" and then renamed
+void
+SimulatedRecorder::onExposureDone() {
+    QString sFileName = QString("%1/%2_%3_%4.jpg")
+                        .arg(sDir)
+                        .arg(sNamePrefix)
+                        .arg(pClock->msecNow())
+                        .arg(nWritten++);
+    QFile file(sFileName + QString("~"));
+    if(file.open(QIODevice::WriteOnly)) {
+        file.write(cannedJpeg);
+        file.close();
+        QFile::rename(file.fileName(), sFileName);
+    }
+    if(--nPendingShots > 0)
+        pExposureTimer->start(SIMULATED_EXPOSURE);
+    else if(bStopRequested)
+        stop();
+}
@@ -0,0 +1,125 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <QObject>
+#include <QProcess>
+#include <sys/types.h>
+#include "clock.h"
+
+
+// One running instance of the camera program.
+// In still mode every trigger() produces a file in the output folder,
+// in continuous mode the frames come out of stream().
+class Recorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Recorder(QObject *parent = nullptr);
+
+    virtual void start() = 0;
+    virtual void stop() = 0;  // Graceful: ends with finished(130, false)
+    virtual void kill() = 0;  // Does not wait: released() follows, no finished()
+    virtual bool trigger() = 0;
+    virtual bool isReady() const = 0;
+    virtual QIODevice* stream() { return Q_NULLPTR; }
+    // Can a second instance wait, ready, while this one is running ?
+    // (never with the real camera: it can be opened only once)
+    virtual bool supportsStandby() const { return false; }
+
+signals:
+    void ready();
+    void finished(int exitCode, bool bCrashed);
+    void released(); // After kill(): the camera can be opened again
+};
+
+
+// raspistill/raspivid
+class ProcessRecorder : public Recorder
+{
+    Q_OBJECT
+
+public:
+    ProcessRecorder(const QString& sCommand, bool bStream, QObject *parent = nullptr);
+    ~ProcessRecorder();
+
+    void start() Q_DECL_OVERRIDE;
+    void stop() Q_DECL_OVERRIDE;
+    void kill() Q_DECL_OVERRIDE;
+    bool trigger() Q_DECL_OVERRIDE;
+    bool isReady() const Q_DECL_OVERRIDE;
+    QIODevice* stream() Q_DECL_OVERRIDE;
+
+protected:
+    bool terminateProcess();
+
+private slots:
+    void onStarted();
+    void onFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void onError(QProcess::ProcessError error);
+
+private:
+    QProcess* pProcess;
+    QString   sCommandLine;
+    bool      bStreamOutput;
+    pid_t     pid;
+};
+
+
+// A camera that needs no camera.
+// It takes startupMsec to become ready (like the camera initialization)
+// and can be told to crash or to hang after a given number of frames,
+// so that failures and recoveries can be reproduced at will.
+class SimulatedRecorder : public Recorder
+{
+    Q_OBJECT
+
+public:
+    SimulatedRecorder(const QString& sDirectory,
+                      const QString& sPrefix,
+                      int fps,
+                      bool bStream,
+                      Clock* pClock,
+                      QObject *parent = nullptr);
+
+    void setStartupTime(int msec) { startupMsec = msec; }
+    void crashAfter(int nFrames)  { crashFrames = nFrames; }
+    void hangAfter(int nFrames)   { hangFrames = nFrames; }
+
+    void start() Q_DECL_OVERRIDE;
+    void stop() Q_DECL_OVERRIDE;
+    void kill() Q_DECL_OVERRIDE;
+    bool trigger() Q_DECL_OVERRIDE;
+    bool isReady() const Q_DECL_OVERRIDE;
+    QIODevice* stream() Q_DECL_OVERRIDE;
+    bool supportsStandby() const Q_DECL_OVERRIDE { return true; }
+
+protected:
+    void halt();
+
+private slots:
+    void onStartupDone();
+    void onExposureDone();
+    void crash();
+
+private:
+    QString     sDir;
+    QString     sNamePrefix;
+    int         iFps;
+    bool        bStreamOutput;
+    Clock*      pClock;
+    QIODevice*  pSource;
+    ClockTimer* pStartupTimer;
+    ClockTimer* pExposureTimer;
+    QByteArray  cannedJpeg;
+    bool        bReady;
+    bool        bStopRequested;
+    int         startupMsec;
+    int         crashFrames;   // 0 = never
+    int         hangFrames;    // 0 = never
+    int         nFrames;
+    int         nPendingShots;
+    int         nWritten;
+};
+
+#endif // RECORDER_H
@@ -0,0 +1,310 @@
+#include "recordersupervisor.h"
+#include <QDebug>
+
+
+#define MIN_BACKOFF   500   // in ms
+#define MAX_BACKOFF   30000 // in ms
+#define MIN_HEARTBEAT 5000  // in ms
+
+
+RecorderSupervisor::RecorderSupervisor(Clock* pClock, QObject *parent)
+    : QObject(parent)
+    , pClock(pClock)
+    , pActive(Q_NULLPTR)
+    , pStandby(Q_NULLPTR)
+    , heartbeatMsec(MIN_HEARTBEAT)
+    , nOutstanding(0)
+    , nFailures(0)
+    , nIncidents(0)
+    , nLostInIncident(0)
+    , nReleasing(0)
+    , bSpawnPending(false)
+    , msecIncidentStart(0)
+    , bRunning(false)
+    , bStopping(false)
+{
+    pHeartbeatTimer = pClock->createTimer(this);
+    pHeartbeatTimer->setSingleShot(true);
+    connect(pHeartbeatTimer,
+            SIGNAL(timeout()),
+            this,
+            SLOT(onHeartbeatTimeout()));
+    pRestartTimer = pClock->createTimer(this);
+    pRestartTimer->setSingleShot(true);
+    connect(pRestartTimer,
+            SIGNAL(timeout()),
+            this,
+            SLOT(onRestartTimeout()));
+}
+
+
+RecorderSupervisor::~RecorderSupervisor() {
+    shutdown();
+}
+
+
+void
+RecorderSupervisor::setFactory(const Factory& recorderFactory) {
+    factory = recorderFactory;
+}
+
+
+void
+RecorderSupervisor::setHeartbeatTimeout(int msec) {
+    heartbeatMsec = qMax(msec, MIN_HEARTBEAT);
+}
+
+
+void
+RecorderSupervisor::start() {
+    bRunning          = true;
+    bStopping         = false;
+    nOutstanding      = 0;
+    nFailures         = 0;
+    msecIncidentStart = 0;
+    spawnActive();
+}
+
+
+void
+RecorderSupervisor::stop() {
+    if(!bRunning)
+        return;
+    bStopping = true;
+    pHeartbeatTimer->stop();
+    pRestartTimer->stop();
+    dismiss(pStandby);
+    if(pActive && pActive->isReady()) {
+        pActive->stop();
+        return;
+    }
+    dismiss(pActive);// Not even started: we are done
+    bSpawnPending = false;
+    bRunning = false;
+    emit finished(130);
+}
+
+
+void
+RecorderSupervisor::shutdown() {
+    pHeartbeatTimer->stop();
+    pRestartTimer->stop();
+    dismiss(pStandby);
+    dismiss(pActive);
+    bSpawnPending = false;
+    bRunning = false;
+}
+
+
+void
+RecorderSupervisor::restart() {
+    if(!bRunning || bStopping)
+        return;
+    pHeartbeatTimer->stop();
+    pRestartTimer->stop();
+    if(nOutstanding > 0)
+        emit recorderLost(nOutstanding);
+    nOutstanding = 0;
+    dismiss(pStandby);
+    dismiss(pActive);
+    spawnActive();
+}
+
+
+bool
+RecorderSupervisor::trigger() {
+    if(!pActive || !pActive->isReady() || !pActive->trigger()) {
+        if(msecIncidentStart != 0)
+            nLostInIncident++;
+        return false;
+    }
+    nOutstanding++;
+    if(!pHeartbeatTimer->isActive())
+        pHeartbeatTimer->start(heartbeatMsec);
+    return true;
+}
+
+
+void
+RecorderSupervisor::frameArrived() {
+    nFailures = 0;// The recorder is working again
+    if(nOutstanding > 0)
+        nOutstanding--;
+    if(nOutstanding > 0)
+        pHeartbeatTimer->start(heartbeatMsec);
+    else
+        pHeartbeatTimer->stop();
+}
+
+
+// A trigger that will not produce a frame even if the recorder is fine
+void
+RecorderSupervisor::frameDropped() {
+    if(nOutstanding > 0)
+        nOutstanding--;
+    if(nOutstanding == 0)
+        pHeartbeatTimer->stop();
+}
+
+
+void
+RecorderSupervisor::spawnActive() {
+    if(nReleasing > 0) {// The camera can be opened only once
+        bSpawnPending = true;
+        return;
+    }
+    pActive = factory(this);
+    connect(pActive,
+            SIGNAL(ready()),
+            this,
+            SLOT(onActiveReady()));
+    connect(pActive,
+            SIGNAL(finished(int, bool)),
+            this,
+            SLOT(onActiveFinished(int, bool)));
+    pActive->start();
+}
+
+
+void
+RecorderSupervisor::spawnStandby() {
+    pStandby = factory(this);
+    connect(pStandby,
+            SIGNAL(finished(int, bool)),
+            this,
+            SLOT(onStandbyFinished(int, bool)));
+    pStandby->start();
+}
+
+
+void
+RecorderSupervisor::promoteStandby() {
+    pActive  = pStandby;
+    pStandby = Q_NULLPTR;
+    pActive->disconnect(this);
+    connect(pActive,
+            SIGNAL(ready()),
+            this,
+            SLOT(onActiveReady()));
+    connect(pActive,
+            SIGNAL(finished(int, bool)),
+            this,
+            SLOT(onActiveFinished(int, bool)));
+    if(pActive->isReady())
+        onActiveReady();
+}
+
+
+void
+RecorderSupervisor::dismiss(Recorder*& pRecorder) {
+    if(!pRecorder)
+        return;
+    pRecorder->disconnect(this);
+    nReleasing++;
+    connect(pRecorder,
+            SIGNAL(released()),
+            this,
+            SLOT(onRecorderReleased()));
+    connect(pRecorder,
+            SIGNAL(released()),
+            pRecorder,
+            SLOT(deleteLater()));
+    pRecorder->kill();// released() may come at once
+    pRecorder = Q_NULLPTR;
+}
+
+
+void
+RecorderSupervisor::onRecorderReleased() {
+    nReleasing--;
+    if((nReleasing > 0) || !bSpawnPending)
+        return;
+    bSpawnPending = false;
+    if(bRunning && !bStopping)
+        spawnActive();
+}
+
+
+void
+RecorderSupervisor::onActiveReady() {
+    if(msecIncidentStart != 0) {
+        qint64 msecDowntime = pClock->msecNow() - msecIncidentStart;
+        qInfo() << "Recorder recovered after" << msecDowntime << "ms,"
+                << nLostInIncident << "frames lost";
+        emit recovered(msecDowntime, nLostInIncident);
+        msecIncidentStart = 0;
+    }
+    emit recorderReady(pActive);
+    if(!pStandby && pActive->supportsStandby())
+        spawnStandby();
+}
+
+
+void
+RecorderSupervisor::onActiveFinished(int exitCode, bool bCrashed) {
+    if(bStopping || (!bCrashed && (exitCode == 0 || exitCode == 130))) {
+        // Stopped by us or recording time elapsed
+        pHeartbeatTimer->stop();
+        dismiss(pStandby);
+        pActive->disconnect(this);
+        pActive->deleteLater();
+        pActive   = Q_NULLPTR;
+        bRunning  = false;
+        bStopping = false;
+        emit finished(exitCode);
+        return;
+    }
+    handleFailure(QString("exit code %1%2")
+                  .arg(exitCode)
+                  .arg(bCrashed ? QString(" (crashed)") : QString()));
+}
+
+
+void
+RecorderSupervisor::onStandbyFinished(int exitCode, bool bCrashed) {
+    Q_UNUSED(bCrashed)
+    qWarning() << "Standby recorder exited with code" << exitCode;
+    pStandby->disconnect(this);
+    pStandby->deleteLater();
+    pStandby = Q_NULLPTR;
+    if(pActive && pActive->isReady())
+        spawnStandby();
+}
+
+
+void
+RecorderSupervisor::onHeartbeatTimeout() {
+    handleFailure(QString("no frame in %1 ms").arg(heartbeatMsec));
+}
+
+
+void
+RecorderSupervisor::handleFailure(const QString& sReason) {
+    pHeartbeatTimer->stop();
+    if(msecIncidentStart == 0) {
+        msecIncidentStart = pClock->msecNow();
+        nLostInIncident   = 0;
+        nIncidents++;
+    }
+    qWarning() << "Recorder failure:" << sReason;
+    nLostInIncident += nOutstanding;
+    emit recorderLost(nOutstanding);
+    nOutstanding = 0;
+    dismiss(pActive);
+    nFailures++;
+
+    if(pStandby) {// Hot swap
+        promoteStandby();
+        return;
+    }
+    int msecBackoff = qMin(MAX_BACKOFF, MIN_BACKOFF << qMin(nFailures-1, 6));
+    qInfo() << "Restarting the recorder in" << msecBackoff << "ms";
+    pRestartTimer->start(msecBackoff);
+}
+
+
+void
+RecorderSupervisor::onRestartTimeout() {
+    if(bRunning && !bStopping)
+        spawnActive();
+}
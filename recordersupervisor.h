@@ -0,0 +1,81 @@
+#ifndef RECORDERSUPERVISOR_H
+#define RECORDERSUPERVISOR_H
+
+#include <QObject>
+#include <functional>
+#include "recorder.h"
+#include "clock.h"
+
+
+// Keeps a Recorder alive for the whole session.
+// A recorder is considered dead when it exits unexpectedly or when no
+// frame arrives for heartbeatMsec after a trigger. It is then replaced
+// by the standby instance, if the backend allows one, or restarted with
+// an exponential backoff. Every incident is logged with its downtime and
+// the number of frames lost. A dismissed recorder is killed without
+// waiting: the next one starts once the camera has been released.
+class RecorderSupervisor : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<Recorder*(QObject*)> Factory;
+
+    explicit RecorderSupervisor(Clock* pClock, QObject *parent = nullptr);
+    ~RecorderSupervisor();
+
+    void setFactory(const Factory& recorderFactory);
+    void setHeartbeatTimeout(int msec);
+    void start();
+    void stop();     // Graceful: finished() will follow
+    void shutdown(); // Immediate, no signals
+    void restart();  // Planned restart (i.e. new command line)
+    bool trigger();
+    bool isRunning() const { return bRunning; }
+    int  incidents() const { return nIncidents; }
+
+public slots:
+    void frameArrived();
+    void frameDropped();
+
+signals:
+    void recorderReady(Recorder* pRecorder);
+    void recorderLost(int nOutstanding); // These frames will never arrive
+    void recovered(qint64 msecDowntime, int nLostFrames);
+    void finished(int exitCode);         // The session is over
+
+private slots:
+    void onActiveReady();
+    void onActiveFinished(int exitCode, bool bCrashed);
+    void onStandbyFinished(int exitCode, bool bCrashed);
+    void onHeartbeatTimeout();
+    void onRestartTimeout();
+    void onRecorderReleased();
+
+private:
+    void spawnActive();
+    void spawnStandby();
+    void promoteStandby();
+    void dismiss(Recorder*& pRecorder);
+    void handleFailure(const QString& sReason);
+
+private:
+    Factory     factory;
+    Clock*      pClock;
+    Recorder*   pActive;
+    Recorder*   pStandby;
+    ClockTimer* pHeartbeatTimer;
+    ClockTimer* pRestartTimer;
+    int       heartbeatMsec;
+    int       nOutstanding;      // Triggered frames not yet arrived
+    int       nFailures;         // Consecutive: drives the backoff
+    int       nIncidents;
+    int       nLostInIncident;
+    int       nReleasing;        // Dismissed, still holding the camera
+    bool      bSpawnPending;     // Waiting for them
+    qint64    msecIncidentStart; // 0 = No incident in progress
+    bool      bRunning;
+    bool      bStopping;
+};
+
+#endif // RECORDERSUPERVISOR_H
@@ -0,0 +1,231 @@
+#include "resourcegovernor.h"
+#include <QDir>
+#include <QFile>
+#include <QThread>
+#include <QDebug>
+
+
+#define CALM_SAMPLES     5    // Below the thresholds before stepping down
+#define CELSIUS_MARGIN   5.0  // Hysteresis on the temperature
+#define LOAD_MARGIN      0.8  // Hysteresis on the load (factor)
+#define LATENCY_MARGIN   0.5  // Hysteresis on the latency (factor)
+
+
+ResourceGovernor::ResourceGovernor(Clock* pClock, const QString& sSysRoot, QObject *parent)
+    : QObject(parent)
+    , pClock(pClock)
+    , sRoot(sSysRoot)
+    , currentLevel(Normal)
+    , warmTemperature(65.0)
+    , hotTemperature(75.0)
+    , highLoad(1.5)
+    , latencyBudget(50)
+    , maxEncoders(QThread::idealThreadCount())
+    , nCores(qMax(1, QThread::idealThreadCount()))
+    , nCalmSamples(0)
+    , windowLatency(0)
+    , bLatencyReported(false)
+    , lastLatency(0)
+    , temperature(-1.0)
+    , load(0.0)
+    , msecLastSample(0)
+{
+    governorStats = GovernorStats();
+    governorStats.maxTemperature = -1.0;
+    setSysRoot(sSysRoot);
+    pSampleTimer = pClock->createTimer(this);
+    connect(pSampleTimer,
+            SIGNAL(timeout()),
+            this,
+            SLOT(sample()));
+}
+
+
+void
+ResourceGovernor::setThresholds(double warmCelsius,
+                                double hotCelsius,
+                                double loadPerCore,
+                                int msecLatencyBudget)
+{
+    warmTemperature = warmCelsius;
+    hotTemperature  = qMax(hotCelsius, warmCelsius);
+    highLoad        = loadPerCore;
+    latencyBudget   = qMax(1, msecLatencyBudget);
+}
+
+
+// Where sys/ and proc/ are (i.e. a fake one for the replays)
+void
+ResourceGovernor::setSysRoot(const QString& sSysRoot) {
+    sRoot = sSysRoot;
+    thermalZones.clear();
+    QDir thermalDir(sRoot + QString("/sys/class/thermal"));
+    QStringList zones = thermalDir.entryList(QStringList() << QString("thermal_zone*"),
+                                             QDir::Dirs | QDir::NoDotAndDotDot);
+    for(int i=0; i<zones.size(); i++) {
+        QString sTempFile = thermalDir.filePath(zones[i] + QString("/temp"));
+        if(QFile::exists(sTempFile))
+            thermalZones.append(sTempFile);
+    }
+    if(thermalZones.isEmpty())
+        qWarning() << "No thermal zones in" << thermalDir.path();
+}
+
+
+void
+ResourceGovernor::setMaxEncoderThreads(int nThreads) {
+    maxEncoders = qMax(1, nThreads);
+}
+
+
+void
+ResourceGovernor::start(int msecPeriod) {
+    governorStats  = GovernorStats();
+    governorStats.level = currentLevel;
+    governorStats.maxTemperature = -1.0;
+    nCalmSamples     = 0;
+    windowLatency    = 0;
+    bLatencyReported = false;
+    lastLatency      = 0;
+    msecLastSample   = pClock->msecNow();
+    pSampleTimer->start(msecPeriod);
+    sample();
+}
+
+
+void
+ResourceGovernor::stop() {
+    pSampleTimer->stop();
+    if(currentLevel != Normal)// The deferred work can now be done
+        apply(Normal, QString("stopped"));
+}
+
+
+void
+ResourceGovernor::reportLatency(int msecLateness) {
+    windowLatency    = qMax(windowLatency, msecLateness);
+    bLatencyReported = true;
+    governorStats.maxLatency = qMax(governorStats.maxLatency, msecLateness);
+}
+
+
+void
+ResourceGovernor::sample() {
+    qint64 msecNow = pClock->msecNow();
+    if(currentLevel >= Reduced)
+        governorStats.msecReduced += msecNow - msecLastSample;
+    if(currentLevel == Minimal)
+        governorStats.msecMinimal += msecNow - msecLastSample;
+    msecLastSample = msecNow;
+
+    temperature = readTemperature();
+    load        = readLoad();
+    // With long intervals most windows have no trigger at all
+    if(bLatencyReported)
+        lastLatency = windowLatency;
+    windowLatency    = 0;
+    bLatencyReported = false;
+    governorStats.maxTemperature = qMax(governorStats.maxTemperature, temperature);
+    governorStats.maxLoad        = qMax(governorStats.maxLoad, load);
+
+    QString sReason;
+    Level target = assess(0.0, &sReason);
+    if(target > currentLevel) {
+        nCalmSamples = 0;
+        apply(target, sReason);
+        return;
+    }
+    // One step down at a time, and only when clearly better
+    Level relaxed = assess(1.0, &sReason);
+    if(relaxed < currentLevel) {
+        if(++nCalmSamples >= CALM_SAMPLES) {
+            nCalmSamples = 0;
+            apply(Level(currentLevel-1), QString("back to normal conditions"));
+        }
+    }
+    else
+        nCalmSamples = 0;
+}
+
+
+// margin 0: the thresholds as they are, 1: lowered by the hysteresis
+ResourceGovernor::Level
+ResourceGovernor::assess(double margin, QString* pReason) {
+    double warm    = warmTemperature - margin*CELSIUS_MARGIN;
+    double hot     = hotTemperature  - margin*CELSIUS_MARGIN;
+    double loadMax = highLoad*(1.0 - margin*(1.0-LOAD_MARGIN));
+    double budget  = latencyBudget*(1.0 - margin*(1.0-LATENCY_MARGIN));
+    Level level = Normal;
+    if(temperature >= hot) {
+        level = Minimal;
+        *pReason = QString("CPU at %1 °C").arg(temperature, 0, 'f', 1);
+    }
+    else if(temperature >= warm) {
+        level = Reduced;
+        *pReason = QString("CPU at %1 °C").arg(temperature, 0, 'f', 1);
+    }
+    if(lastLatency > 2.0*budget) {
+        level = Minimal;
+        *pReason = QString("capture %1 ms late").arg(lastLatency);
+    }
+    else if((lastLatency > budget) && (level < Reduced)) {
+        level = Reduced;
+        *pReason = QString("capture %1 ms late").arg(lastLatency);
+    }
+    if((load >= loadMax) && (level < Reduced)) {
+        level = Reduced;
+        *pReason = QString("load %1 per core").arg(load, 0, 'f', 2);
+    }
+    return level;
+}
+
+
+void
+ResourceGovernor::apply(Level newLevel, const QString& sReason) {
+    Level oldLevel = currentLevel;
+    currentLevel = newLevel;
+    governorStats.level       = newLevel;
+    governorStats.sLastReason = sReason;
+    governorStats.nChanges++;
+    qInfo() << "Governor: level" << oldLevel << "->" << newLevel << "(" << sReason << ")";
+
+    int nEncoders = maxEncoders;
+    if(newLevel == Reduced)
+        nEncoders = qMax(1, maxEncoders/2);
+    else if(newLevel == Minimal)
+        nEncoders = 1;
+    emit encoderThreadsChanged(nEncoders);
+    if((oldLevel == Normal) != (newLevel == Normal))
+        emit packingPaused(newLevel != Normal);
+    if((oldLevel == Minimal) != (newLevel == Minimal))
+        emit encodingPaused(newLevel == Minimal);
+    emit levelChanged(newLevel, sReason);
+}
+
+
+// The hottest zone, in °C (the files are in m°C). -1 if unknown
+double
+ResourceGovernor::readTemperature() {
+    double hottest = -1.0;
+    for(int i=0; i<thermalZones.size(); i++) {
+        QFile file(thermalZones[i]);
+        if(!file.open(QIODevice::ReadOnly))
+            continue;
+        bool bOk;
+        int milliCelsius = file.readAll().trimmed().toInt(&bOk);
+        if(bOk)
+            hottest = qMax(hottest, milliCelsius/1000.0);
+    }
+    return hottest;
+}
+
+
+// 1 minute load average per core. 0 if unknown
+double
+ResourceGovernor::readLoad() {
+    QFile file(sRoot + QString("/proc/loadavg"));
+    if(!file.open(QIODevice::ReadOnly))
+        return 0.0;
+    QList<QByteArray> fields = file.readAll().split(' ');
+    return fields.first().toDouble()/nCores;
+}
@@ -0,0 +1,100 @@
+#ifndef RESOURCEGOVERNOR_H
+#define RESOURCEGOVERNOR_H
+
+#include <QObject>
+#include <QStringList>
+#include "clock.h"
+
+
+// What the governor did in the current session
+struct GovernorStats
+{
+    int     level;          // The current one
+    int     nChanges;
+    qint64  msecReduced;    // Time spent at Reduced or below
+    qint64  msecMinimal;
+    double  maxTemperature; // in °C, -1 if unknown
+    double  maxLoad;        // 1 minute load average per core
+    int     maxLatency;     // Worst trigger lateness reported (ms)
+    QString sLastReason;
+};
+
+
+// Keeps the background work from heating the Pi into thermal throttling,
+// which would make the capture late.
+// Every period it reads the CPU temperature from
+// <root>/sys/class/thermal/thermal_zone*/temp and the load from
+// <root>/proc/loadavg, and combines them with the capture lateness
+// reported by the scheduler:
+//   Normal   all the encoder threads, packing on;
+//   Reduced  half of the encoder threads, packing paused;
+//   Minimal  one encoder thread, profile encoding paused as well.
+// A level is entered as soon as a threshold is crossed, and left only
+// after CALM_SAMPLES samples well below it. The paused work is deferred,
+// never dropped. The root is "/" but for testing against fake files.
+class ResourceGovernor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Level {
+        Normal,
+        Reduced,
+        Minimal
+    };
+    Q_ENUM(Level)
+
+    ResourceGovernor(Clock* pClock,
+                     const QString& sSysRoot = QString("/"),
+                     QObject *parent = nullptr);
+
+    void setThresholds(double warmCelsius,
+                       double hotCelsius,
+                       double loadPerCore,
+                       int msecLatencyBudget);
+    void setSysRoot(const QString& sSysRoot);
+    void setMaxEncoderThreads(int nThreads);
+    void start(int msecPeriod);
+    void stop();                     // Back to Normal
+    Level level() const { return currentLevel; }
+    const GovernorStats& stats() const { return governorStats; }
+
+public slots:
+    void reportLatency(int msecLateness);
+    void sample();
+
+signals:
+    void levelChanged(int level, const QString& sReason);
+    void encoderThreadsChanged(int nThreads);
+    void packingPaused(bool bPaused);
+    void encodingPaused(bool bPaused);
+
+protected:
+    double readTemperature();
+    double readLoad();
+    Level  assess(double margin, QString* pReason);
+    void   apply(Level newLevel, const QString& sReason);
+
+private:
+    Clock*        pClock;
+    ClockTimer*   pSampleTimer;
+    QString       sRoot;
+    QStringList   thermalZones;    // The temp files
+    GovernorStats governorStats;
+    Level         currentLevel;
+    double        warmTemperature;
+    double        hotTemperature;
+    double        highLoad;
+    int           latencyBudget;   // in ms
+    int           maxEncoders;
+    int           nCores;
+    int           nCalmSamples;
+    int           windowLatency;   // Worst lateness since the last sample
+    bool          bLatencyReported;
+    int           lastLatency;     // Of the last window with triggers
+    double        temperature;
+    double        load;
+    qint64        msecLastSample;
+};
+
+#endif // RESOURCEGOVERNOR_H
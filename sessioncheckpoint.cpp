@@ -0,0 +1,111 @@
+#include "sessioncheckpoint.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QFile>
+#include <QStandardPaths>
+#include <QDir>
+#include <QDebug>
+
+
+#define CHECKPOINT_MAGIC   0x49534350 // "ISCP"
+#define CHECKPOINT_VERSION 2
+
+
+SessionCheckpoint::SessionCheckpoint(const QString& sFileName)
+    : sCheckpointFile(sFileName)
+{
+    QDir().mkpath(QFileInfo(sCheckpointFile).absolutePath());
+}
+
+
+// One per application name (see --instance)
+QString
+SessionCheckpoint::defaultFileName() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+           QString("/session.ckpt");
+}
+
+
+bool
+SessionCheckpoint::save(const SessionState& state) {
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << state.sSessionId
+        << state.msecStart
+        << qint32(state.msecInterval)
+        << qint32(state.secTotTime)
+        << state.msecEnd
+        << qint32(state.nCaptured)
+        << qint32(state.nextFrame)
+        << state.sBaseDir
+        << state.sOutFileName
+        << state.bContinuous
+        << state.bRunning;
+
+    QSaveFile file(sCheckpointFile);
+    if(!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Unable to write" << sCheckpointFile;
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << quint32(CHECKPOINT_MAGIC)
+           << quint32(CHECKPOINT_VERSION)
+           << payload
+           << QCryptographicHash::hash(payload, QCryptographicHash::Md5);
+    return file.commit();
+}
+
+
+bool
+SessionCheckpoint::load(SessionState* pState) const {
+    QFile file(sCheckpointFile);
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic, version;
+    QByteArray payload, hash;
+    stream >> magic >> version >> payload >> hash;
+    if((stream.status() != QDataStream::Ok) ||
+       (magic != CHECKPOINT_MAGIC) ||
+       (version < 1) || (version > CHECKPOINT_VERSION) ||
+       (hash != QCryptographicHash::hash(payload, QCryptographicHash::Md5)))
+    {
+        qWarning() << "Invalid session checkpoint" << sCheckpointFile;
+        return false;
+    }
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_5_0);
+    qint32 msecInterval, secTotTime, nCaptured, nextFrame;
+    in >> pState->sSessionId
+       >> pState->msecStart
+       >> msecInterval
+       >> secTotTime;
+    if(version > 1)
+        in >> pState->msecEnd;
+    else if((secTotTime > 0) && (pState->msecStart != 0))// The grid never moved
+        pState->msecEnd = pState->msecStart - msecInterval + qint64(secTotTime)*1000;
+    else
+        pState->msecEnd = 0;
+    in >> nCaptured
+       >> nextFrame
+       >> pState->sBaseDir
+       >> pState->sOutFileName
+       >> pState->bContinuous
+       >> pState->bRunning;
+    pState->msecInterval = msecInterval;
+    pState->secTotTime   = secTotTime;
+    pState->nCaptured    = nCaptured;
+    pState->nextFrame    = nextFrame;
+    return in.status() == QDataStream::Ok;
+}
+
+
+void
+SessionCheckpoint::clear() {
+    QFile::remove(sCheckpointFile);
+}
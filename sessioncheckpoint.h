@@ -0,0 +1,47 @@
+#ifndef SESSIONCHECKPOINT_H
+#define SESSIONCHECKPOINT_H
+
+#include <QString>
+
+
+// Everything needed to resume a time lapse after a power loss.
+// The frame numbers follow the schedule grid (frame N is taken at
+// msecStart + N*msecInterval), so the session can be resumed knowing
+// only when it started: nothing has to be rebuilt from the output folder.
+// A new interval moves the origin, so that the frames already taken keep
+// their numbers, but not the end of the session: it is kept apart.
+struct SessionState
+{
+    QString sSessionId;
+    qint64  msecStart;    // Origin of the schedule grid (ms since Epoch)
+    int     msecInterval;
+    int     secTotTime;   // 0 = No limit
+    qint64  msecEnd;      // No frame from here on (0 = No limit)
+    int     nCaptured;    // Frames taken up to the last checkpoint
+    int     nextFrame;    // Grid slot of the next frame
+    QString sBaseDir;
+    QString sOutFileName;
+    bool    bContinuous;
+    bool    bRunning;     // false once the session has been closed
+};
+
+
+// A tiny file holding the SessionState.
+// It is written to a temporary file, synced and renamed over the old one
+// (QSaveFile), so after a crash we find either the old or the new state.
+class SessionCheckpoint
+{
+public:
+    explicit SessionCheckpoint(const QString& sFileName = defaultFileName());
+
+    bool save(const SessionState& state);
+    bool load(SessionState* pState) const;
+    void clear();
+    QString fileName() const { return sCheckpointFile; }
+    static QString defaultFileName();
+
+private:
+    QString sCheckpointFile;
+};
+
+#endif // SESSIONCHECKPOINT_H
@@ -0,0 +1,167 @@
+#include "sessionreplay.h"
+#include "mainwindow.h"
+#include "sessioncheckpoint.h"
+#include "clock.h"
+#include "gpio.h"
+#include "configstore.h"
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QJsonArray>
+
+
+#define MAX_LATENESS     20   // in ms
+#define LAMP_TOLERANCE   0.01 // On the duty cycle
+#define STILL_LAMP_MSEC  310  // Lamp on time for a still (see onTimeToGetNewImage)
+#define REPLAY_START     Q_INT64_C(1577836800000) // 2020-01-01 00:00:00 UTC
+#define STOP_MARGIN      60000 // in ms
+
+
+QJsonObject
+ReplayReport::toJson() const {
+    QJsonObject json;
+    json["expectedFrames"]    = nExpectedFrames;
+    json["triggers"]          = nTriggers;
+    json["captured"]          = nCaptured;
+    json["missedSlots"]       = nMissedSlots;
+    json["maxLatenessMs"]     = msecMaxLateness;
+    json["meanLatenessMs"]    = msecMeanLateness;
+    json["lampDutyCycle"]     = lampDutyCycle;
+    json["expectedDutyCycle"] = expectedDutyCycle;
+    json["lampPulses"]        = nLampPulses;
+    json["incidents"]         = nIncidents;
+    json["timersFired"]       = nTimersFired;
+    json["governorChanges"]   = nGovernorChanges;
+    json["governorReducedMs"] = double(msecGovernorReduced);
+    json["wallTimeMs"]        = double(msecWallTime);
+    json["usecPerFrame"]      = usecPerFrame;
+    json["failures"]          = QJsonArray::fromStringList(failures);
+    json["passed"]            = failures.isEmpty();
+    return json;
+}
+
+
+SessionReplay::SessionReplay(int msecInterval, int secDuration, bool bContinuous)
+    : msecInterval(msecInterval)
+    , secDuration(secDuration)
+    , bContinuous(bContinuous)
+    , crashAfter(0)
+    , hangAfter(0)
+{
+}
+
+
+bool
+SessionReplay::run(ReplayReport* pReport) {
+    ReplayReport& report = *pReport;
+    report = ReplayReport();
+    QTemporaryDir outDir;
+    if(!outDir.isValid()) {
+        report.failures.append(QString("Unable to create the output folder"));
+        return false;
+    }
+    SessionCheckpoint().clear();// Nothing to resume
+
+    VirtualClock clock(REPLAY_START);
+    SimulatedGpio gpio(&clock);
+    // MainWindow takes everything from the settings: a file of our own,
+    // validated as if typed in
+    ConfigStore config(&clock, outDir.filePath("replay.conf"));
+    QVariantMap settings;
+    settings[Config::BaseDir.sName]             = outDir.path();
+    settings[Config::FileName.sName]            = QString("replay");
+    settings[Config::Continuous.sName]          = bContinuous;
+    settings[Config::Interval.sName]            = msecInterval;
+    settings[Config::TotalTime.sName]           = secDuration;
+    settings[Config::SimulatedCamera.sName]     = true;
+    settings[Config::SimulatedCrashAfter.sName] = crashAfter;
+    settings[Config::SimulatedHangAfter.sName]  = hangAfter;
+    settings[Config::PackFrames.sName]          = false;// It runs on the wall clock
+    settings[Config::SyncMode.sName]            = QString("off");
+    settings[Config::SysfsRoot.sName]           = outDir.path();// No temperature, no load
+    QString sError;
+    if(!config.setValues(settings, &sError)) {
+        report.failures.append(sError);
+        return false;
+    }
+    {
+        MainWindow window(&clock, &gpio, &config);
+        window.startRecording();
+        QElapsedTimer wallTime;
+        wallTime.start();
+        qint64 msecEnd = clock.msecNow() + qint64(secDuration)*1000 + STOP_MARGIN;
+        while(window.isRecording() && (clock.msecNow() < msecEnd)) {
+            if(!clock.advance())
+                break;
+        }
+        report.msecWallTime = wallTime.elapsed();
+        if(window.isRecording())
+            report.failures.append(QString("The session did not end in time"));
+
+        const SessionState&  session = window.sessionState();
+        const ScheduleStats& stats   = window.scheduleStats();
+        report.nExpectedFrames  = int(qint64(secDuration)*1000/msecInterval);
+        report.nTriggers        = stats.nTriggers;
+        report.nCaptured        = session.nCaptured;
+        report.nMissedSlots     = stats.nMissedSlots;
+        report.msecMaxLateness  = stats.msecMaxLateness;
+        report.msecMeanLateness = stats.nTriggers ? double(stats.msecLatenessSum)/stats.nTriggers : 0.0;
+        report.nIncidents       = window.recorderIncidents();
+        report.nTimersFired     = clock.timersFired();
+        report.nGovernorChanges    = window.governorStats().nChanges;
+        report.msecGovernorReduced = window.governorStats().msecReduced;
+        report.usecPerFrame     = stats.nTriggers ? 1000.0*report.msecWallTime/stats.nTriggers : 0.0;
+        report.nLampPulses      = gpio.risingEdges(window.lampPin());
+        report.lampDutyCycle    = double(gpio.msecHigh(window.lampPin()))/(qint64(secDuration)*1000);
+        window.close();
+    }
+
+    // The checks
+    int nSlots = report.nTriggers + report.nMissedSlots;
+    if(qAbs(nSlots - report.nExpectedFrames) > 1)
+        report.failures.append(QString("%1 slots instead of %2")
+                               .arg(nSlots)
+                               .arg(report.nExpectedFrames));
+    if(report.msecMaxLateness > MAX_LATENESS)
+        report.failures.append(QString("A frame was %1 ms late")
+                               .arg(report.msecMaxLateness));
+    if(bContinuous) {
+        report.expectedDutyCycle = 1.0;// On from the first frame to the end
+        if(report.nLampPulses != 1)// Recoveries leave it on
+            report.failures.append(QString("The lamp was switched on %1 times")
+                                   .arg(report.nLampPulses));
+    }
+    else {
+        report.expectedDutyCycle = double(report.nTriggers)*STILL_LAMP_MSEC/(qint64(secDuration)*1000);
+        if(report.nLampPulses != report.nTriggers)
+            report.failures.append(QString("%1 lamp pulses for %2 triggers")
+                                   .arg(report.nLampPulses)
+                                   .arg(report.nTriggers));
+    }
+    if(qAbs(report.lampDutyCycle - report.expectedDutyCycle) > LAMP_TOLERANCE)
+        report.failures.append(QString("Lamp duty cycle %1 instead of %2")
+                               .arg(report.lampDutyCycle)
+                               .arg(report.expectedDutyCycle));
+    if(report.nGovernorChanges != 0)
+        report.failures.append(QString("The governor reduced the background work %1 times")
+                               .arg(report.nGovernorChanges));
+    if(crashAfter || hangAfter) {
+        if(report.nIncidents == 0)
+            report.failures.append(QString("No recorder failure seen"));
+        // At most what was in flight, for every incident
+        if(report.nCaptured < report.nTriggers - 3*report.nIncidents)
+            report.failures.append(QString("%1 frames for %2 triggers and %3 incidents")
+                                   .arg(report.nCaptured)
+                                   .arg(report.nTriggers)
+                                   .arg(report.nIncidents));
+    }
+    else {
+        if(report.nIncidents != 0)
+            report.failures.append(QString("%1 unexpected recorder failures")
+                                   .arg(report.nIncidents));
+        if(report.nCaptured < report.nTriggers - (bContinuous ? 2 : 0))
+            report.failures.append(QString("%1 frames for %2 triggers")
+                                   .arg(report.nCaptured)
+                                   .arg(report.nTriggers));
+    }
+    return report.failures.isEmpty();
+}
@@ -0,0 +1,60 @@
+#ifndef SESSIONREPLAY_H
+#define SESSIONREPLAY_H
+
+#include <QJsonObject>
+#include <QStringList>
+#include <QtGlobal>
+
+
+struct ReplayReport
+{
+    int         nExpectedFrames;
+    int         nTriggers;
+    int         nCaptured;
+    int         nMissedSlots;
+    int         msecMaxLateness;
+    double      msecMeanLateness;
+    double      lampDutyCycle;
+    double      expectedDutyCycle;
+    int         nLampPulses;
+    int         nIncidents;
+    int         nTimersFired;
+    int         nGovernorChanges;
+    qint64      msecGovernorReduced;
+    qint64      msecWallTime;
+    double      usecPerFrame;   // Wall time spent by the scheduler per frame
+    QStringList failures;       // Empty if every check passed
+
+    QJsonObject toJson() const;
+};
+
+
+// Runs a whole session of the real MainWindow on a VirtualClock, with the
+// simulated camera and GPIO, and checks what came out of it:
+//  - every slot of the grid has been either triggered or counted as missed;
+//  - no trigger happened later than the tolerance;
+//  - every trigger produced a frame (but the ones lost in a recorder failure);
+//  - the lamp has been on exactly as long as expected;
+//  - recorder failures, if injected, have been recovered;
+//  - the governor never had a reason to reduce the background work
+//    (the system files are fake, so only the lateness counts).
+// A day at a 10 s interval replays in seconds, so it doubles as a
+// benchmark of the scheduler overhead per frame.
+class SessionReplay
+{
+public:
+    SessionReplay(int msecInterval, int secDuration, bool bContinuous);
+
+    void setCrashAfter(int nFrames) { crashAfter = nFrames; }
+    void setHangAfter(int nFrames)  { hangAfter = nFrames; }
+    bool run(ReplayReport* pReport);
+
+private:
+    int  msecInterval;
+    int  secDuration;
+    bool bContinuous;
+    int  crashAfter;
+    int  hangAfter;
+};
+
+#endif // SESSIONREPLAY_H
@@ -1,10 +1,10 @@
 #include "setupdialog.h"
 #include "ui_setupdialog.h"
-#include <signal.h>
 #include "pigpiod_if2.h"// The library for using GPIO pins on Raspberry
-#include <QMoveEvent>
+#include <QCloseEvent>
 #include <QMessageBox>
-#include <QSettings>
+#include <QPainter>
+#include <QVarLengthArray>
 #include <QThread>
 #include <QDebug>
 
@@ -13,11 +13,18 @@
 #define PAN_PIN  14 // BCM14 is Pin  8 in the 40 pin GPIO connector.
 #define TILT_PIN 26 // BCM26 IS Pin 37 in the 40 pin GPIO connector.
 
+#define PREVIEW_BUFFERS     3
+#define PREVIEW_BUFFER_SIZE (1024*1024) // Enough for a preview sized MJPEG frame
 
-setupDialog::setupDialog(int hostHandle, QWidget *parent)
+#define CLIPPED_WARNING 1.0 // in % of the measured area
+
+
+setupDialog::setupDialog(Gpio* pGpio, Clock* pClock, ConfigStore* pConfig, QWidget *parent)
     : QDialog(parent)
     , pUi(new Ui::setupDialog)
-    , pImageRecorder(Q_NULLPTR)
+    , pPreviewRecorder(Q_NULLPTR)
+    , bHaveMeters(false)
+    , maxSharpness(0.0)
     // ================================================
     // GPIO Numbers are Broadcom (BCM) numbers
     // ================================================
@@ -27,7 +34,8 @@ setupDialog::setupDialog(int hostHandle, QWidget *parent)
     // ================================================
     , panPin(PAN_PIN)
     , tiltPin(TILT_PIN)
-    , gpioHostHandle(hostHandle)
+    , pGpio(pGpio)
+    , pConfig(pConfig)
 {
     pUi->setupUi(this);
     setFixedSize(size());
@@ -47,105 +55,106 @@ setupDialog::setupDialog(int hostHandle, QWidget *parent)
     if(!panTiltInit())
         exit(EXIT_FAILURE);
 
+    // The camera stream, painted in labelVideo
+    pFramePool     = new FrameBufferPool(PREVIEW_BUFFERS, PREVIEW_BUFFER_SIZE);
+    pStreamCapture = new StreamCapture(pFramePool, this);
+    pPreview       = new PreviewRenderer(pUi->labelVideo, pClock, this);
+    connect(pStreamCapture,
+            SIGNAL(frameSeen(const char*, int)),
+            pPreview,
+            SLOT(showFrame(const char*, int)),
+            Qt::DirectConnection);
+
+    // The framing assist: measured in the decoder thread, shown here
+    pPreview->setMetersEnabled(true);
+    connect(pPreview,
+            SIGNAL(metersReady(FrameMeters)),
+            this,
+            SLOT(onMetersReady(FrameMeters)));
+    pUi->labelHistogram->installEventFilter(this);
+
     restoreSettings();
+    // The camera can be aimed by editing the settings too (i.e. headless)
+    connect(pConfig,
+            SIGNAL(changed(QString, QVariant)),
+            this,
+            SLOT(onConfigChanged(QString, QVariant)));
 }
 
 
 setupDialog::~setupDialog() {
-    if(pImageRecorder) {
-        pImageRecorder->terminate();
-        pImageRecorder->close();
-        pImageRecorder->waitForFinished(3000);
-        delete pImageRecorder;
-        pImageRecorder = nullptr;
-    }
+    stopPreview();
+    delete pStreamCapture;
+    delete pFramePool;
     delete pUi;
 }
 
 
+void
+setupDialog::setPreviewSource(const RecorderSupervisor::Factory& factory) {
+    previewFactory = factory;
+}
+
+
 void
 setupDialog::closeEvent(QCloseEvent *event) {
-    if(event->type() == QCloseEvent::Close) {
-        if(pImageRecorder) {
-            pImageRecorder->disconnect();
-            pImageRecorder->terminate();
-            pImageRecorder->close();
-            pImageRecorder->waitForFinished(3000);
-            delete pImageRecorder;
-            pImageRecorder = nullptr;
-        }
-    }
+    if(event->type() == QCloseEvent::Close)
+        stopPreview();
 }
 
 
 int
 setupDialog::exec() {
-    pImageRecorder = new QProcess(this);
-    connect(pImageRecorder,
-            SIGNAL(finished(int, QProcess::ExitStatus)),
-            this,
-            SLOT(onImageRecorderClosed(int, QProcess::ExitStatus)));
-    connect(pImageRecorder,
-            SIGNAL(errorOccurred(QProcess::ProcessError)),
+    startPreview();
+    int iResult = QDialog::exec();
+    stopPreview();
+    return iResult;
+}
+
+
+void
+setupDialog::startPreview() {
+    if(pPreviewRecorder || !previewFactory)
+        return;
+    pPreview->clear();
+    bHaveMeters  = false;
+    maxSharpness = 0.0;
+    pUi->labelSharpness->setText(QString("Sharpness -"));
+    pUi->labelClipped->setText(QString("Clipped -"));
+    pUi->labelHistogram->update();
+    pPreviewRecorder = previewFactory(this);
+    connect(pPreviewRecorder,
+            SIGNAL(ready()),
             this,
-            SLOT(onImageRecorderError(QProcess::ProcessError)));
-    connect(pImageRecorder,
-            SIGNAL(started()),
+            SLOT(onPreviewReady()));
+    connect(pPreviewRecorder,
+            SIGNAL(finished(int, bool)),
             this,
-            SLOT(onImageRecorderStarted()));
-    return QDialog::exec();
+            SLOT(onPreviewFinished(int, bool)));
+    pPreviewRecorder->start();
 }
 
 
 void
-setupDialog::moveEvent(QMoveEvent *event) {
-    if(pImageRecorder) {
-        QPoint dialogPos = event->pos();
-        QPoint videoPos = pUi->labelVideo->pos();
-        QSize videoSize = pUi->labelVideo->size();
-
-        QString sCommand = QString("/usr/bin/raspistill");
-        QStringList sArguments = QStringList();
-        sArguments.append(QString("-ex auto"));                  // Exposure mode; Auto
-        sArguments.append(QString("-awb auto"));                 // White Balance; Auto
-        sArguments.append(QString("-drc off"));                  // Dynamic Range Compression: off
-        sArguments.append(QString("-vf"));                       // Vertical Flip
-        sArguments.append(QString("-md 1"));                     // Mode 1 (1920x1080)
-        sArguments.append(QString("-t 0"));
-        sArguments.append(QString("-p %1,%2,%3,%4")
-                          .arg(dialogPos.x()+videoPos.x())
-                          .arg(dialogPos.y()+videoPos.y())
-                          .arg(videoSize.width())
-                          .arg(videoSize.height()));
-
-////////////////////////////////////////////////////////////
-/// Here we could use the following (Not working at present)
-//    pImageRecorder->setProgram(sCommand);
-//    pImageRecorder->setArguments(sArguments);
-//    pImageRecorder->start();
-/// Instead we have to use:
-        for(int i=0; i<sArguments.size(); i++)
-            sCommand += QString(" %1").arg(sArguments[i]);
-////////////////////////////////////////////////////////////
-        if(pImageRecorder->state() == QProcess::NotRunning)
-            pImageRecorder->start(sCommand);
-        else {
-            pImageRecorder->disconnect();
-            pImageRecorder->terminate();
-            pImageRecorder->close();
-            pImageRecorder->waitForFinished(3000);
-            pImageRecorder->start(sCommand);
-        }
-    }
+setupDialog::stopPreview() {
+    if(!pPreviewRecorder)
+        return;
+    pStreamCapture->stop();
+    pPreviewRecorder->disconnect(this);
+    connect(pPreviewRecorder,
+            SIGNAL(released()),
+            pPreviewRecorder,
+            SLOT(deleteLater()));
+    pPreviewRecorder->kill();
+    pPreviewRecorder = Q_NULLPTR;
 }
 
 
 void
 setupDialog::restoreSettings() {
-    QSettings settings;
     // Restore settings
-    cameraPanValue  = settings.value("panValue",  cameraPanValue).toDouble();
-    cameraTiltValue = settings.value("tiltValue", cameraTiltValue).toDouble();
+    cameraPanValue  = pConfig->value(Config::PanValue);
+    cameraTiltValue = pConfig->value(Config::TiltValue);
     pUi->dialPan->setValue(int(cameraPanValue));
     pUi->dialTilt->setValue(int(cameraTiltValue));
 }
@@ -155,7 +164,7 @@ bool
 setupDialog::panTiltInit() {
     int iResult;
     // Camera Pan-Tilt Control
-    iResult = set_PWM_frequency(gpioHostHandle, panPin, PWMfrequency);
+    iResult = pGpio->setPwmFrequency(panPin, PWMfrequency);
     if(iResult < 0) {
         QMessageBox::critical(this,
                               QString("pigpiod Error"),
@@ -173,7 +182,7 @@ setupDialog::panTiltInit() {
 bool
 setupDialog::setPan(double cameraPanValue) {
     double pulseWidth = cameraPanValue;// In us
-    int iResult = set_servo_pulsewidth(gpioHostHandle, panPin, u_int32_t(pulseWidth));
+    int iResult = pGpio->setServoPulseWidth(panPin, unsigned(pulseWidth));
     if(iResult < 0) {
         QString sError;
         if(iResult == PI_BAD_USER_GPIO)
@@ -189,8 +198,8 @@ setupDialog::setPan(double cameraPanValue) {
                               QString("Non riesco a far partire il PWM per il Pan."));
         return false;
     }
-    set_PWM_frequency(gpioHostHandle, panPin, 0);
-    iResult = set_PWM_frequency(gpioHostHandle, tiltPin, 0);
+    pGpio->setPwmFrequency(panPin, 0);
+    iResult = pGpio->setPwmFrequency(tiltPin, 0);
     if(iResult == PI_BAD_USER_GPIO) {
         QMessageBox::critical(this,
                               QString("pigpiod Error"),
@@ -210,14 +219,14 @@ setupDialog::setPan(double cameraPanValue) {
 bool
 setupDialog::setTilt(double cameraTiltValue) {
     double pulseWidth = cameraTiltValue;// In us
-    int iResult = set_PWM_frequency(gpioHostHandle, tiltPin, PWMfrequency);
+    int iResult = pGpio->setPwmFrequency(tiltPin, PWMfrequency);
     if(iResult < 0) {
         QMessageBox::critical(this,
                               QString("pigpiod Error"),
                               QString("Non riesco a definire la frequenza del PWM per il Tilt."));
         return false;
     }
-    iResult = set_servo_pulsewidth(gpioHostHandle, tiltPin, u_int32_t(pulseWidth));
+    iResult = pGpio->setServoPulseWidth(tiltPin, unsigned(pulseWidth));
     if(iResult < 0) {
         QString sError;
         if(iResult == PI_BAD_USER_GPIO)
@@ -233,7 +242,7 @@ setupDialog::setTilt(double cameraTiltValue) {
                               QString("Non riesco a far partire il PWM per il Tilt."));
         return false;
     }
-    iResult = set_PWM_frequency(gpioHostHandle, tiltPin, 0);
+    iResult = pGpio->setPwmFrequency(tiltPin, 0);
     if(iResult == PI_BAD_USER_GPIO) {
         QMessageBox::critical(this,
                               QString("pigpiod Error"),
@@ -256,70 +265,108 @@ setupDialog::setTilt(double cameraTiltValue) {
 void
 setupDialog::on_buttonBox_accepted() {
     // Save settings
-    QSettings settings;
-    settings.setValue("panValue",  cameraPanValue);
-    settings.setValue("tiltValue", cameraTiltValue);
-    if(pImageRecorder) {
-        pImageRecorder->disconnect();
-        pImageRecorder->terminate();
-        pImageRecorder->close();
-        pImageRecorder->waitForFinished(3000);
-        delete pImageRecorder;
-        pImageRecorder = nullptr;
-    }
+    pConfig->setValue(Config::PanValue,  cameraPanValue);
+    pConfig->setValue(Config::TiltValue, cameraTiltValue);
+    stopPreview();
     accept();
 }
 
 
+// The dials move the servos
+void
+setupDialog::onConfigChanged(const QString& sKey, const QVariant& value) {
+    if(sKey == Config::PanValue.sName)
+        pUi->dialPan->setValue(int(value.toDouble()));
+    else if(sKey == Config::TiltValue.sName)
+        pUi->dialTilt->setValue(int(value.toDouble()));
+}
+
+
 void
 setupDialog::on_buttonBox_rejected() {
-    if(pImageRecorder) {
-        pImageRecorder->disconnect();
-        pImageRecorder->terminate();
-        pImageRecorder->close();
-        pImageRecorder->waitForFinished(3000);
-        delete pImageRecorder;
-        pImageRecorder = nullptr;
-    }
+    stopPreview();
     reject();
 }
 
 
 void
-setupDialog::onImageRecorderStarted() {
-    pid = pid_t(pImageRecorder->processId());
+setupDialog::onPreviewReady() {
+    pStreamCapture->start(pPreviewRecorder->stream());
 }
 
 
 void
-setupDialog::onImageRecorderError(QProcess::ProcessError error) {
-    Q_UNUSED(error)
-    QMessageBox::critical(this,
-                          QString("raspistill"),
-                          QString("Error %1")
-                          .arg(error));
-    QList<QWidget *> widgets = findChildren<QWidget *>();
-    for(int i=0; i<widgets.size(); i++) {
-        widgets[i]->setEnabled(true);
+setupDialog::onPreviewFinished(int exitCode, bool bCrashed) {
+    pStreamCapture->stop();
+    pPreviewRecorder->disconnect(this);
+    pPreviewRecorder->deleteLater();
+    pPreviewRecorder = Q_NULLPTR;
+    if(bCrashed || (exitCode != 130)) {// exitStatus==130 means process killed by Ctrl-C
+        QMessageBox::critical(this,
+                              QString("Preview"),
+                              QString("The camera exited with code %1%2")
+                              .arg(exitCode)
+                              .arg(bCrashed ? QString(" (crashed)") : QString()));
     }
 }
 
 
+// The sharpness only means something compared with the other values of
+// the same scene: the best one so far is shown next to it.
 void
-setupDialog::onImageRecorderClosed(int exitCode, QProcess::ExitStatus exitStatus) {
-    pImageRecorder->disconnect();
-    delete pImageRecorder;
-    pImageRecorder = nullptr;
-    if(exitCode != 130) {// exitStatus==130 means process killed by Ctrl-C
-        QMessageBox::critical(this,
-                              QString("raspistill"),
-                              QString("exited with status: %1, Exit code: %2")
-                              .arg(exitStatus)
-                              .arg(exitCode));
+setupDialog::onMetersReady(const FrameMeters& frameMeters) {
+    meters       = frameMeters;
+    bHaveMeters  = true;
+    maxSharpness = qMax(maxSharpness, meters.sharpness);
+    pUi->labelSharpness->setText(QString("Sharpness %1 / %2")
+                                 .arg(meters.sharpness, 0, 'f', 0)
+                                 .arg(maxSharpness, 0, 'f', 0));
+    pUi->labelClipped->setText(QString("Clipped %1 %")
+                               .arg(meters.clipped, 0, 'f', 1));
+    // Restyling costs far more than a comparison: only on changes
+    QString sStyle = (meters.clipped > CLIPPED_WARNING) ? QString("color: red") : QString();
+    if(pUi->labelClipped->styleSheet() != sStyle)
+        pUi->labelClipped->setStyleSheet(sStyle);
+    pUi->labelHistogram->update();
+}
+
+
+bool
+setupDialog::eventFilter(QObject* pObject, QEvent* pEvent) {
+    if((pObject != pUi->labelHistogram) || (pEvent->type() != QEvent::Paint))
+        return QDialog::eventFilter(pObject, pEvent);
+    paintHistogram(pUi->labelHistogram);
+    return true;
+}
+
+
+// One column per pixel, the mean of its bins, scaled to the fullest
+// column; the clipped highlights in red.
+void
+setupDialog::paintHistogram(QWidget* pWidget) {
+    QPainter painter(pWidget);
+    painter.fillRect(pWidget->rect(), Qt::black);
+    if(!bHaveMeters)
+        return;
+    int width  = pWidget->width();
+    int height = pWidget->height();
+    QVarLengthArray<quint32, 512> columns(width);
+    quint32 maxColumn = 1;
+    for(int x=0; x<width; x++) {
+        int iFirst = x*256/width;
+        int iLast  = qMax(iFirst+1, (x+1)*256/width);
+        quint32 sum = 0;
+        for(int iBin=iFirst; iBin<iLast; iBin++)
+            sum += meters.histogram[iBin];
+        columns[x] = sum/quint32(iLast-iFirst);
+        maxColumn  = qMax(maxColumn, columns[x]);
     }
-    QList<QWidget *> widgets = findChildren<QWidget *>();
-    for(int i=0; i<widgets.size(); i++) {
-        widgets[i]->setEnabled(true);
+    for(int x=0; x<width; x++) {
+        int barHeight = int(qint64(columns[x])*height/maxColumn);
+        if(barHeight == 0)
+            continue;
+        painter.setPen((x*256/width >= CLIP_LEVEL) ? Qt::red : Qt::white);
+        painter.drawLine(x, height-1, x, height-barHeight);
     }
 }
 
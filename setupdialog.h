@@ -2,8 +2,13 @@
 #define SETUPDIALOG_H
 
 #include <QDialog>
-#include <QProcess>
-#include <sys/types.h>
+#include "gpio.h"
+#include "clock.h"
+#include "recordersupervisor.h"
+#include "framebufferpool.h"
+#include "streamcapture.h"
+#include "previewrenderer.h"
+#include "configstore.h"
 
 namespace Ui {
 class setupDialog;
@@ -14,24 +19,32 @@ class setupDialog : public QDialog
     Q_OBJECT
 
 public:
-    explicit setupDialog(int hostHandle, QWidget *parent = nullptr);
+    setupDialog(Gpio* pGpio, Clock* pClock, ConfigStore* pConfig, QWidget *parent = nullptr);
     ~setupDialog();
+    // What shows the camera while aiming it (a stream mode Recorder)
+    void setPreviewSource(const RecorderSupervisor::Factory& factory);
+    int panPulseWidth() const  { return int(cameraPanValue); }  // in us
+    int tiltPulseWidth() const { return int(cameraTiltValue); } // in us
 
 protected:
     void closeEvent(QCloseEvent *event);
+    bool eventFilter(QObject* pObject, QEvent* pEvent) Q_DECL_OVERRIDE;
+    void paintHistogram(QWidget* pWidget);
     void restoreSettings();
     bool panTiltInit();
     bool setPan(double cameraPanValue);
     bool setTilt(double cameraTiltValue);
+    void startPreview();
+    void stopPreview();
 
 public slots:
-    void onImageRecorderClosed(int exitCode, QProcess::ExitStatus exitStatus);
-    void onImageRecorderStarted();
-    void onImageRecorderError(QProcess::ProcessError error);
+    void onPreviewReady();
+    void onPreviewFinished(int exitCode, bool bCrashed);
+    void onMetersReady(const FrameMeters& frameMeters);
+    void onConfigChanged(const QString& sKey, const QVariant& value);
     void on_dialTilt_valueChanged(int value);
     void on_dialPan_valueChanged(int value);
     int  exec();
-    void moveEvent(QMoveEvent *event);
 
 private slots:
     void on_buttonBox_accepted();
@@ -40,8 +53,14 @@ private slots:
 
 private:
     Ui::setupDialog* pUi;
-    QProcess*        pImageRecorder;
-    pid_t pid;
+    Recorder*        pPreviewRecorder;
+    FrameBufferPool* pFramePool;
+    StreamCapture*   pStreamCapture;
+    PreviewRenderer* pPreview;
+    RecorderSupervisor::Factory previewFactory;
+    FrameMeters      meters;
+    bool             bHaveMeters;
+    double           maxSharpness;   // Since the preview started
 
     uint   panPin;
     uint   tiltPin;
@@ -50,7 +69,8 @@ private:
     uint   PWMfrequency;     // in Hz
     int    pulseWidthAt_90;  // in us
     int    pulseWidthAt90;   // in us
-    int    gpioHostHandle;
+    Gpio*  pGpio;
+    ConfigStore* pConfig;
 };
 
 #endif // SETUPDIALOG_H
@@ -0,0 +1,142 @@
+#include "simulatedmjpegsource.h"
+#include "mjpegparser.h"
+#include <QBuffer>
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QDebug>
+
+
+#define DEFAULT_FRAMES 8
+
+
+SimulatedMjpegSource::SimulatedMjpegSource(int fps, Clock* pClock, QObject *parent)
+    : QIODevice(parent)
+    , msecFrame(1000/qMax(fps, 1))
+    , iFrame(0)
+    , iReadPos(0)
+    , iPending(0)
+    , iChunk(4096)
+{
+    pFrameTimer = pClock->createTimer(this);
+    connect(pFrameTimer,
+            SIGNAL(timeout()),
+            this,
+            SLOT(onFrameTimer()));
+    makeDefaultStream();
+}
+
+
+void
+SimulatedMjpegSource::makeDefaultStream() {
+    QByteArray mjpeg;
+    QImage image(640, 480, QImage::Format_RGB32);
+    for(int i=0; i<DEFAULT_FRAMES; i++) {
+        image.fill(QColor::fromHsv(i*360/DEFAULT_FRAMES, 128, 160));
+        QPainter painter(&image);
+        painter.fillRect(i*(640-64)/DEFAULT_FRAMES, 208, 64, 64, Qt::white);
+        painter.end();
+        QBuffer buffer(&mjpeg);
+        buffer.open(QIODevice::Append);
+        image.save(&buffer, "JPG", 80);
+    }
+    setCannedStream(mjpeg);
+}
+
+
+bool
+SimulatedMjpegSource::setCannedStream(const QByteArray& mjpegStream) {
+    MjpegParser parser;
+    const unsigned char* pData = reinterpret_cast<const unsigned char*>(mjpegStream.constData());
+    QVector<int> ends;
+    int iEnd = 0;
+    while((iEnd = parser.scan(pData, iEnd, mjpegStream.size())) > 0)
+        ends.append(iEnd);
+    if(ends.isEmpty()) {
+        qWarning() << "No JPEG frames in the canned stream";
+        return false;
+    }
+    stream    = mjpegStream.left(ends.last());
+    frameEnds = ends;
+    iFrame    = 0;
+    iReadPos  = 0;
+    iPending  = 0;
+    return true;
+}
+
+
+bool
+SimulatedMjpegSource::loadCannedStream(const QString& sFileName) {
+    QFile file(sFileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Unable to open" << sFileName;
+        return false;
+    }
+    return setCannedStream(file.readAll());
+}
+
+
+bool
+SimulatedMjpegSource::open(OpenMode mode) {
+    if(!QIODevice::open(mode | QIODevice::Unbuffered))
+        return false;
+    pFrameTimer->start(msecFrame);
+    return true;
+}
+
+
+void
+SimulatedMjpegSource::close() {
+    pFrameTimer->stop();
+    iPending = 0;
+    QIODevice::close();
+}
+
+
+bool
+SimulatedMjpegSource::isSequential() const {
+    return true;
+}
+
+
+qint64
+SimulatedMjpegSource::bytesAvailable() const {
+    return iPending + QIODevice::bytesAvailable();
+}
+
+
+void
+SimulatedMjpegSource::onFrameTimer() {
+    // A stalled reader would block raspivid on the pipe: stop producing
+    if(iPending > stream.size())
+        return;
+    int iStart = (iFrame == 0) ? 0 : frameEnds[iFrame-1];
+    iPending += frameEnds[iFrame] - iStart;
+    iFrame = (iFrame+1) % frameEnds.size();
+    emit readyRead();
+}
+
+
+qint64
+SimulatedMjpegSource::readData(char *data, qint64 maxlen) {
+    qint64 toRead = qMin(qMin(maxlen, iPending), qint64(iChunk));
+    qint64 done = 0;
+    while(done < toRead) {
+        qint64 n = qMin(toRead-done, qint64(stream.size()-iReadPos));
+        memcpy(data+done, stream.constData()+iReadPos, size_t(n));
+        done += n;
+        iReadPos = (iReadPos + int(n)) % stream.size();
+    }
+    iPending -= done;
+    // Vary the chunk size so that frame boundaries fall everywhere
+    iChunk = 512 + (iChunk*7919) % 65536;
+    return done;
+}
+
+
+qint64
+SimulatedMjpegSource::writeData(const char *data, qint64 len) {
+    Q_UNUSED(data)
+    Q_UNUSED(len)
+    return -1;
+}
@@ -0,0 +1,48 @@
+#ifndef SIMULATEDMJPEGSOURCE_H
+#define SIMULATEDMJPEGSOURCE_H
+
+#include <QIODevice>
+#include <QVector>
+#include "clock.h"
+
+
+// A stand-in for "raspivid -cd MJPEG -o -" used to exercise the continuous
+// capture path without a camera. It cycles over a canned MJPEG byte stream
+// releasing one frame every 1/fps seconds and hands the data out in
+// irregular chunks, so that frames straddle the reads like on a real pipe.
+class SimulatedMjpegSource : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    SimulatedMjpegSource(int fps, Clock* pClock = Clock::system(), QObject *parent = nullptr);
+
+    bool setCannedStream(const QByteArray& mjpegStream);
+    bool loadCannedStream(const QString& sFileName);
+    int  cannedFrames() const { return frameEnds.size(); }
+
+    bool open(OpenMode mode) Q_DECL_OVERRIDE;
+    void close() Q_DECL_OVERRIDE;
+    bool isSequential() const Q_DECL_OVERRIDE;
+    qint64 bytesAvailable() const Q_DECL_OVERRIDE;
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) Q_DECL_OVERRIDE;
+    qint64 writeData(const char *data, qint64 len) Q_DECL_OVERRIDE;
+    void   makeDefaultStream();
+
+private slots:
+    void onFrameTimer();
+
+private:
+    QByteArray   stream;
+    QVector<int> frameEnds;
+    ClockTimer*  pFrameTimer;
+    int          msecFrame;
+    int          iFrame;
+    int          iReadPos;
+    qint64       iPending;
+    int          iChunk;
+};
+
+#endif // SIMULATEDMJPEGSOURCE_H
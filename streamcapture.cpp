@@ -0,0 +1,123 @@
+#include "streamcapture.h"
+#include <QDateTime>
+#include <string.h>
+
+
+#define MAX_PENDING_REQUESTS 2
+
+
+StreamCapture::StreamCapture(FrameBufferPool* pPool, QObject *parent)
+    : QObject(parent)
+    , pPool(pPool)
+    , pCurrent(Q_NULLPTR)
+    , nRequested(0)
+    , nDropped(0)
+{
+}
+
+
+StreamCapture::~StreamCapture() {
+    stop();
+}
+
+
+void
+StreamCapture::start(QIODevice* pStreamSource) {
+    stop();
+    pSource  = pStreamSource;
+    pCurrent = pPool->acquire();
+    connect(pSource,
+            SIGNAL(readyRead()),
+            this,
+            SLOT(onReadyRead()));
+    if(!pSource->isOpen())
+        pSource->open(QIODevice::ReadOnly);
+}
+
+
+void
+StreamCapture::stop() {
+    if(pSource)
+        pSource->disconnect(this);
+    pSource.clear();
+    pPool->release(pCurrent);
+    pCurrent = Q_NULLPTR;
+    parser.reset();
+    nRequested = 0;
+}
+
+
+bool
+StreamCapture::grabNextFrame() {
+    if(nRequested >= MAX_PENDING_REQUESTS) {
+        nDropped++;// The stream is slower than the requested interval
+        return false;
+    }
+    nRequested++;
+    return true;
+}
+
+
+void
+StreamCapture::onReadyRead() {
+    while(pSource && pCurrent && pSource->bytesAvailable() > 0) {
+        int space = pCurrent->capacity - pCurrent->size;
+        if(space == 0) {// Frame larger than a buffer or no SOI at all
+            nDropped++;
+            parser.reset();
+            pCurrent->size = 0;
+            space = pCurrent->capacity;
+        }
+        qint64 nRead = pSource->read(pCurrent->data+pCurrent->size, space);
+        if(nRead <= 0)
+            break;
+        int from = pCurrent->size;
+        pCurrent->size += int(nRead);
+        int iEnd;
+        while(pCurrent &&
+              (iEnd = parser.scan(reinterpret_cast<const unsigned char*>(pCurrent->data),
+                                  from,
+                                  pCurrent->size)) > 0)
+        {
+            onFrameEnd(iEnd);
+            from = 0;
+        }
+        // Whatever precedes a SOI is garbage: keep only the last byte
+        // since it could be the first half of the marker
+        if(pCurrent && parser.frameStart() < 0 && pCurrent->size > 1) {
+            pCurrent->data[0] = pCurrent->data[pCurrent->size-1];
+            pCurrent->size = 1;
+        }
+    }
+}
+
+
+void
+StreamCapture::onFrameEnd(int iEnd) {
+    FrameBuffer* pFrame = pCurrent;
+    int iStart    = parser.frameStart();
+    int remainder = pFrame->size - iEnd;
+    parser.reset();
+    emit frameSeen(pFrame->data+iStart, iEnd-iStart);
+
+    FrameBuffer* pNext = Q_NULLPTR;
+    if(nRequested > 0) {
+        pNext = pPool->acquire();
+        if(!pNext)// Every buffer is still in use downstream
+            nDropped++;
+    }
+    if(!pNext) {// Nobody wants this frame: recycle the buffer
+        memmove(pFrame->data, pFrame->data+iEnd, size_t(remainder));
+        pFrame->size = remainder;
+        return;
+    }
+    memcpy(pNext->data, pFrame->data+iEnd, size_t(remainder));
+    pNext->size = remainder;
+    pCurrent = pNext;
+    nRequested--;
+
+    pFrame->offset        = iStart;
+    pFrame->size          = iEnd-iStart;
+    pFrame->msecTimestamp = QDateTime::currentMSecsSinceEpoch();
+    emit frameCaptured(pFrame);
+}
@@ -0,0 +1,52 @@
+#ifndef STREAMCAPTURE_H
+#define STREAMCAPTURE_H
+
+#include <QObject>
+#include <QPointer>
+#include <QIODevice>
+#include "framebufferpool.h"
+#include "mjpegparser.h"
+
+
+// Extracts single JPEG frames from a continuous MJPEG stream
+// (i.e. the standard output of "raspivid -cd MJPEG -o -").
+// The stream is read directly into the buffers of a FrameBufferPool and
+// the frames found by the MjpegParser are handed out in place: only the
+// few bytes of the next frame that shared the last read are moved.
+// Frames that nobody asked for are simply overwritten.
+class StreamCapture : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StreamCapture(FrameBufferPool* pPool, QObject *parent = nullptr);
+    ~StreamCapture();
+
+    void start(QIODevice* pStreamSource);
+    void stop();
+    bool grabNextFrame();
+    int  droppedFrames() const { return nDropped; }
+
+signals:
+    // The receiver owns the buffer and has to give it back to the pool
+    void frameCaptured(FrameBuffer* pFrame);
+    // Every frame of the stream, requested or not (i.e. for the preview).
+    // The data are valid only during the call: direct connections only.
+    void frameSeen(const char* pData, int size);
+
+private slots:
+    void onReadyRead();
+
+private:
+    void onFrameEnd(int iEnd);
+
+private:
+    FrameBufferPool*    pPool;
+    QPointer<QIODevice> pSource;
+    FrameBuffer*        pCurrent;
+    MjpegParser         parser;
+    int                 nRequested;
+    int                 nDropped;
+};
+
+#endif // STREAMCAPTURE_H
@@ -0,0 +1,258 @@
+#include "syncnode.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <time.h>
+
+
+#define SYNC_MAGIC      0x49535359 // "ISSY"
+#define SYNC_VERSION    1
+#define MSG_REQUEST     1
+#define MSG_REPLY       2
+#define REQUEST_PERIOD  1000   // in ms
+#define LOG_PERIOD      60000  // in ms
+#define LEADER_TIMEOUT  10000  // in ms
+#define FILTER_SAMPLES  8
+
+
+SyncNode::SyncNode(Role nodeRole, const QString& sNodeName, QObject *parent)
+    : QObject(parent)
+    , nodeRole(nodeRole)
+    , sName(sNodeName)
+    , leaderPort(0)
+    , sequence(0)
+    , usecOffset(0)
+    , bSynchronized(false)
+    , msecLastReply(0)
+    , nFrames(0)
+    , msecLatenessSum(0)
+    , msecMaxLateness(0)
+{
+    currentSchedule.msecStart    = 0;
+    currentSchedule.msecInterval = 0;
+    currentSchedule.secTotTime   = 0;
+    currentSchedule.bRunning     = false;
+    connect(&socket,
+            SIGNAL(readyRead()),
+            this,
+            SLOT(onReadyRead()));
+    connect(&requestTimer,
+            SIGNAL(timeout()),
+            this,
+            SLOT(sendRequest()));
+    connect(&logTimer,
+            SIGNAL(timeout()),
+            this,
+            SLOT(logNodes()));
+}
+
+
+qint64
+SyncNode::nowUsec() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return qint64(now.tv_sec)*1000000 + now.tv_nsec/1000;
+}
+
+
+bool
+SyncNode::listen(quint16 port) {
+    if(!socket.bind(QHostAddress::AnyIPv4, port)) {
+        qWarning() << "Sync leader: unable to bind port" << port;
+        return false;
+    }
+    logTimer.start(LOG_PERIOD);
+    qInfo() << "Sync leader" << sName << "listening on port" << port;
+    return true;
+}
+
+
+// Several followers can run on the same machine: each one gets its own port
+bool
+SyncNode::follow(const QHostAddress& leader, quint16 port) {
+    if(!socket.bind(QHostAddress::AnyIPv4, 0)) {
+        qWarning() << "Sync follower: unable to bind";
+        return false;
+    }
+    leaderAddress = leader;
+    leaderPort    = port;
+    requestTimer.start(REQUEST_PERIOD);
+    sendRequest();
+    return true;
+}
+
+
+void
+SyncNode::setSchedule(const SharedSchedule& schedule) {
+    currentSchedule = schedule;
+}
+
+
+qint64
+SyncNode::toLocalMsec(qint64 msecLeader) const {
+    return msecLeader + usecOffset/1000;
+}
+
+
+void
+SyncNode::frameTriggered(int msecLateness) {
+    nFrames++;
+    msecLatenessSum += msecLateness;
+    msecMaxLateness  = qMax(msecMaxLateness, msecLateness);
+}
+
+
+void
+SyncNode::sendRequest() {
+    qint64 msecNow = QDateTime::currentMSecsSinceEpoch();
+    if(bSynchronized && (msecNow-msecLastReply > LEADER_TIMEOUT)) {
+        qWarning() << "Sync follower" << sName << ": no answer from the leader";
+        msecLastReply = msecNow;// Once every LEADER_TIMEOUT
+    }
+    QByteArray datagram;
+    QDataStream out(&datagram, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << quint32(SYNC_MAGIC)
+        << quint8(SYNC_VERSION)
+        << quint8(MSG_REQUEST)
+        << quint32(++sequence)
+        << sName
+        << usecOffset
+        << (samples.isEmpty() ? qint64(0) : samples.last().usecDelay)
+        << qint32(nFrames)
+        << (nFrames ? double(msecLatenessSum)/nFrames : 0.0)
+        << qint32(msecMaxLateness)
+        << nowUsec();// t1: the last thing written, as late as possible
+    socket.writeDatagram(datagram, leaderAddress, leaderPort);
+}
+
+
+void
+SyncNode::onReadyRead() {
+    while(socket.hasPendingDatagrams()) {
+        QByteArray datagram(int(socket.pendingDatagramSize()), 0);
+        QHostAddress sender;
+        quint16 senderPort;
+        socket.readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
+        qint64 usecReceived = nowUsec();// t2 or t4
+        QDataStream in(datagram);
+        in.setVersion(QDataStream::Qt_5_0);
+        quint32 magic;
+        quint8 version, type;
+        in >> magic >> version >> type;
+        if((in.status() != QDataStream::Ok) ||
+           (magic != SYNC_MAGIC) ||
+           (version != SYNC_VERSION))
+            continue;
+        if((nodeRole == Leader) && (type == MSG_REQUEST))
+            onRequest(in, sender, senderPort, usecReceived);
+        else if((nodeRole == Follower) && (type == MSG_REPLY))
+            onReply(in, usecReceived);
+    }
+}
+
+
+void
+SyncNode::onRequest(QDataStream& in, const QHostAddress& sender, quint16 senderPort, qint64 usecReceived) {
+    quint32 seq;
+    NodeStats stats;
+    qint32 nNodeFrames, msecNodeMaxLateness;
+    qint64 t1;
+    in >> seq
+       >> stats.sNode
+       >> stats.usecOffset
+       >> stats.usecDelay
+       >> nNodeFrames
+       >> stats.msecMeanLateness
+       >> msecNodeMaxLateness
+       >> t1;
+    if(in.status() != QDataStream::Ok)
+        return;
+    stats.address         = sender;
+    stats.nFrames         = nNodeFrames;
+    stats.msecMaxLateness = msecNodeMaxLateness;
+    stats.msecLastSeen    = QDateTime::currentMSecsSinceEpoch();
+    if(!followers.contains(stats.sNode))
+        qInfo() << "Sync leader: node" << stats.sNode << "joined from" << sender.toString();
+    followers.insert(stats.sNode, stats);
+    emit nodeUpdated(stats);
+
+    QByteArray datagram;
+    QDataStream out(&datagram, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << quint32(SYNC_MAGIC)
+        << quint8(SYNC_VERSION)
+        << quint8(MSG_REPLY)
+        << seq
+        << t1
+        << usecReceived
+        << currentSchedule.sSessionId
+        << currentSchedule.msecStart
+        << qint32(currentSchedule.msecInterval)
+        << qint32(currentSchedule.secTotTime)
+        << currentSchedule.bRunning
+        << nowUsec();// t3
+    socket.writeDatagram(datagram, sender, senderPort);
+}
+
+
+void
+SyncNode::onReply(QDataStream& in, qint64 usecReceived) {
+    quint32 seq;
+    qint64 t1, t2, t3;
+    qint32 msecInterval, secTotTime;
+    SharedSchedule schedule;
+    in >> seq
+       >> t1
+       >> t2
+       >> schedule.sSessionId
+       >> schedule.msecStart
+       >> msecInterval
+       >> secTotTime
+       >> schedule.bRunning
+       >> t3;
+    if((in.status() != QDataStream::Ok) || (seq != sequence))
+        return;// Malformed or late: a stale reply would only add noise
+    schedule.msecInterval = msecInterval;
+    schedule.secTotTime   = secTotTime;
+    qint64 t4 = usecReceived;
+    // Here the offset is leader - follower: we keep follower - leader
+    Sample sample;
+    sample.usecOffset = -((t2-t1) + (t3-t4))/2;
+    sample.usecDelay  = (t4-t1) - (t3-t2);
+    samples.append(sample);
+    if(samples.size() > FILTER_SAMPLES)
+        samples.remove(0);
+    // The least delayed sample is the least asymmetric one
+    Sample best = samples.first();
+    for(int i=1; i<samples.size(); i++)
+        if(samples[i].usecDelay < best.usecDelay)
+            best = samples[i];
+    msecLastReply = QDateTime::currentMSecsSinceEpoch();
+    if(!bSynchronized || (best.usecOffset != usecOffset)) {
+        if(!bSynchronized)
+            qInfo() << "Sync follower" << sName << ": offset" << best.usecOffset
+                    << "us, round trip" << best.usecDelay << "us";
+        bSynchronized = true;
+        usecOffset    = best.usecOffset;
+        emit offsetChanged(usecOffset);
+    }
+    emit scheduleReceived(schedule);
+}
+
+
+void
+SyncNode::logNodes() {
+    qint64 msecNow = QDateTime::currentMSecsSinceEpoch();
+    QMap<QString, NodeStats>::const_iterator it;
+    for(it=followers.constBegin(); it!=followers.constEnd(); ++it) {
+        const NodeStats& stats = it.value();
+        qInfo() << "Sync node" << stats.sNode
+                << ": offset" << stats.usecOffset << "us"
+                << ", round trip" << stats.usecDelay << "us"
+                << "," << stats.nFrames << "frames"
+                << ", lateness mean" << stats.msecMeanLateness << "ms"
+                << "max" << stats.msecMaxLateness << "ms"
+                << ", last seen" << (msecNow-stats.msecLastSeen)/1000 << "s ago";
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef SYNCNODE_H
+#define SYNCNODE_H
+
+#include <QObject>
+#include <QHostAddress>
+#include <QUdpSocket>
+#include <QTimer>
+#include <QMap>
+#include <QVector>
+
+
+// The session schedule as seen by the leader: frame N of every node is
+// due at msecStart + N*msecInterval of the leader clock.
+struct SharedSchedule
+{
+    QString sSessionId;
+    qint64  msecStart;    // Leader clock (ms since Epoch)
+    int     msecInterval;
+    int     secTotTime;
+    bool    bRunning;
+};
+
+
+// What the leader knows about a follower
+struct NodeStats
+{
+    QString      sNode;
+    QHostAddress address;
+    qint64       usecOffset;       // Follower clock - leader clock
+    qint64       usecDelay;        // Round trip of the best sample
+    int          nFrames;
+    double       msecMeanLateness; // Trigger time - scheduled time
+    int          msecMaxLateness;
+    qint64       msecLastSeen;
+};
+
+
+// Keeps several units on the same schedule.
+// The leader answers the followers' requests with its timestamps and the
+// current SharedSchedule. The followers estimate their clock offset the
+// NTP way, on four timestamps:
+//
+//   offset = ((t2-t1) + (t3-t4))/2    delay = (t4-t1) - (t3-t2)
+//
+// keeping the sample with the smallest delay among the last few ones,
+// and piggyback their trigger statistics on every request.
+class SyncNode : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Role {
+        Leader,
+        Follower
+    };
+
+    SyncNode(Role nodeRole, const QString& sNodeName, QObject *parent = nullptr);
+
+    bool listen(quint16 port);                               // Leader
+    bool follow(const QHostAddress& leader, quint16 port);   // Follower
+    Role role() const { return nodeRole; }
+    quint16 localPort() const { return socket.localPort(); }// i.e. after listen(0)
+
+    void setSchedule(const SharedSchedule& schedule);        // Leader
+    QList<NodeStats> nodes() const { return followers.values(); }
+
+    bool   isSynchronized() const { return bSynchronized; }  // Follower
+    qint64 toLocalMsec(qint64 msecLeader) const;
+    void   frameTriggered(int msecLateness);
+
+    static qint64 nowUsec();
+
+signals:
+    void scheduleReceived(const SharedSchedule& schedule);
+    void offsetChanged(qint64 usecOffset);
+    void nodeUpdated(const NodeStats& stats);
+
+private slots:
+    void onReadyRead();
+    void sendRequest();
+    void logNodes();
+
+private:
+    void onRequest(QDataStream& in, const QHostAddress& sender, quint16 senderPort, qint64 usecReceived);
+    void onReply(QDataStream& in, qint64 usecReceived);
+
+private:
+    struct Sample {
+        qint64 usecOffset;
+        qint64 usecDelay;
+    };
+    Role           nodeRole;
+    QString        sName;
+    QUdpSocket     socket;
+    QTimer         requestTimer;
+    QTimer         logTimer;
+    // Leader
+    SharedSchedule currentSchedule;
+    QMap<QString, NodeStats> followers;
+    // Follower
+    QHostAddress   leaderAddress;
+    quint16        leaderPort;
+    quint32        sequence;
+    QVector<Sample> samples;
+    qint64         usecOffset;
+    bool           bSynchronized;
+    qint64         msecLastReply;
+    int            nFrames;
+    qint64         msecLatenessSum;
+    int            msecMaxLateness;
+};
+
+#endif // SYNCNODE_H
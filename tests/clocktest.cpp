@@ -0,0 +1,59 @@
+#include "clocktest.h"
+#include <QtTest>
+#include <QPointer>
+#include "clock.h"
+
+
+// Earliest first, and first started first on the same deadline
+void
+ClockTest::order() {
+    VirtualClock clock(1000);
+    QObject owner;
+    ClockTimer* pLate  = clock.createTimer(&owner);
+    ClockTimer* pFirst = clock.createTimer(&owner);
+    ClockTimer* pSame  = clock.createTimer(&owner);
+    pLate->setSingleShot(true);
+    pFirst->setSingleShot(true);
+    pSame->setSingleShot(true);
+    QStringList fired;
+    connect(pLate,  &ClockTimer::timeout, [&fired]() { fired << "late"; });
+    connect(pFirst, &ClockTimer::timeout, [&fired]() { fired << "first"; });
+    connect(pSame,  &ClockTimer::timeout, [&fired]() { fired << "same"; });
+    pLate->start(500);
+    pFirst->start(100);
+    pSame->start(100);
+    clock.runUntil(2000);
+    QCOMPARE(fired, QStringList() << "first" << "same" << "late");
+    QCOMPARE(clock.msecNow(), qint64(1500));
+    QCOMPARE(clock.timersFired(), 3);
+}
+
+
+void
+ClockTest::deferredDelete() {
+    VirtualClock clock(0);
+    QObject owner;
+    QPointer<QObject> pDismissed = new QObject;
+    ClockTimer* pTimer = clock.createTimer(&owner);
+    pTimer->setSingleShot(true);
+    connect(pTimer, &ClockTimer::timeout, [&pDismissed]() { pDismissed->deleteLater(); });
+    pTimer->start(10);
+    QVERIFY(clock.advance());
+    QVERIFY(pDismissed.isNull());
+}
+
+
+void
+ClockTest::outlived() {
+    QObject owner;
+    ClockTimer* pTimer;
+    {
+        VirtualClock clock(0);
+        pTimer = clock.createTimer(&owner);
+        pTimer->start(10);
+    }
+    QVERIFY(!pTimer->isActive());
+    pTimer->start(10);
+    QVERIFY(!pTimer->isActive());
+    delete pTimer;
+}
@@ -0,0 +1,19 @@
+#ifndef CLOCKTEST_H
+#define CLOCKTEST_H
+
+#include <QObject>
+
+
+// The VirtualClock: timers fired in order, the deleteLater()s done on
+// the way, and timers that outlive their clock.
+class ClockTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void order();
+    void deferredDelete();
+    void outlived();
+};
+
+#endif // CLOCKTEST_H
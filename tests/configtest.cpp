@@ -0,0 +1,87 @@
+#include "configtest.h"
+#include <QtTest>
+#include "configstore.h"
+#include "clock.h"
+
+
+void
+ConfigTest::initTestCase() {
+    QVERIFY(configDir.isValid());
+}
+
+
+// The old value is kept
+void
+ConfigTest::refused() {
+    VirtualClock clock(0);
+    ConfigStore store(&clock, configDir.filePath("refused.conf"));
+    int msecInterval = store.value(Config::Interval);
+    QString sError;
+    QVERIFY(!store.setValue(Config::Interval, MIN_STREAM_INTERVAL, &sError));
+    QVERIFY(sError.startsWith(Config::Interval.sName));
+    QCOMPARE(store.value(Config::Interval), msecInterval);
+    QVERIFY(!store.setValue(QString("Interval"), QString("soon"), &sError));
+    QVERIFY(!store.setValue(QString("NoSuchKey"), 1, &sError));
+}
+
+
+void
+ConfigTest::coalesced() {
+    QString sFile = configDir.filePath("coalesced.conf");
+    VirtualClock clock(0);
+    {
+        ConfigStore store(&clock, sFile);
+        QSignalSpy changes(&store, SIGNAL(changed(QString, QVariant)));
+        store.setValue(Config::Continuous, true);
+        for(int i=0; i<100; i++)
+            store.setValue(Config::Interval, MIN_STREAM_INTERVAL + i);
+        QCOMPARE(changes.count(), 101);
+        QVERIFY(clock.advance());
+        QTRY_COMPARE(store.writes(), 1);
+    }
+    ConfigStore reread(&clock, sFile);
+    QCOMPARE(reread.value(Config::Continuous), true);
+    QCOMPARE(reread.value(Config::Interval), MIN_STREAM_INTERVAL + 99);
+}
+
+
+// A change that would make another key invalid is refused, unless both
+// change together
+void
+ConfigTest::crossKeys() {
+    VirtualClock clock(0);
+    ConfigStore store(&clock, configDir.filePath("crossKeys.conf"));
+    QVERIFY(store.setValue(Config::Continuous, true));
+    QVERIFY(store.setValue(Config::Interval, MIN_STREAM_INTERVAL));
+    QVERIFY(!store.setValue(Config::Continuous, false));
+    QCOMPARE(store.value(Config::Continuous), true);
+    QVariantMap changes;
+    changes[Config::Continuous.sName] = false;
+    changes[Config::Interval.sName]   = MIN_INTERVAL;
+    QVERIFY(store.setValues(changes));
+    QCOMPARE(store.value(Config::Interval), MIN_INTERVAL);
+    double hot = store.value(Config::ThermalHot);
+    QVERIFY(store.setValue(Config::ThermalWarm, hot - 1.0));
+    QVERIFY(!store.setValue(Config::ThermalHot, hot - 2.0));
+    QCOMPARE(store.value(Config::ThermalHot), hot);
+}
+
+
+// A follower needs a host[:port] leader, given with the mode on the
+// command line
+void
+ConfigTest::syncLeader() {
+    VirtualClock clock(0);
+    ConfigStore store(&clock, configDir.filePath("syncLeader.conf"));
+    QVERIFY(!store.setValue(Config::SyncMode, QString("follower")));
+    QVERIFY(!store.setValue(Config::SyncLeader, QString("leader:port")));
+    QVERIFY(!store.setValue(Config::SyncLeader, QString("leader:70000")));
+    QVERIFY(!store.setValue(Config::SyncLeader, QString(":45454")));
+    QVariantMap overrides;
+    overrides[Config::SyncMode.sName]   = QString("follower");
+    overrides[Config::SyncLeader.sName] = QString("leader.local:45455");
+    QVERIFY(store.setOverrides(overrides));
+    QCOMPARE(store.value(Config::SyncMode), QString("follower"));
+    QVERIFY(store.setValue(Config::SyncLeader, QString("192.168.1.10")));
+    QVERIFY(!store.setValue(Config::SyncLeader, QString()));
+}
@@ -0,0 +1,25 @@
+#ifndef CONFIGTEST_H
+#define CONFIGTEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+
+// The ConfigStore: what is refused, and that a burst of changes is a
+// single write.
+class ConfigTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void refused();
+    void coalesced();
+    void crossKeys();
+    void syncLeader();
+
+private:
+    QTemporaryDir configDir;
+};
+
+#endif // CONFIGTEST_H
@@ -0,0 +1,95 @@
+#include "governortest.h"
+#include <QtTest>
+#include "resourcegovernor.h"
+#include "clock.h"
+
+
+void
+GovernorTest::initTestCase() {
+    QVERIFY(sysRoot.isValid());
+    QDir root(sysRoot.path());
+    QVERIFY(root.mkpath("sys/class/thermal/thermal_zone0"));
+    QVERIFY(root.mkpath("sys/class/thermal/thermal_zone1"));
+    QVERIFY(root.mkpath("proc"));
+    setTemperature(45.0);
+    setLoad(0.2);
+}
+
+
+void
+GovernorTest::setTemperature(double celsius) {
+    QFile zone0(sysRoot.filePath("sys/class/thermal/thermal_zone0/temp"));
+    QVERIFY(zone0.open(QIODevice::WriteOnly));
+    zone0.write(QByteArray::number(int(celsius*1000.0)) + "\n");
+    QFile zone1(sysRoot.filePath("sys/class/thermal/thermal_zone1/temp"));
+    QVERIFY(zone1.open(QIODevice::WriteOnly));
+    zone1.write("30000\n");// Only the hottest counts
+}
+
+
+void
+GovernorTest::setLoad(double load) {
+    QFile file(sysRoot.filePath("proc/loadavg"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray::number(load*QThread::idealThreadCount(), 'f', 2) +
+               " 0.50 0.40 1/123 4567\n");
+}
+
+
+void
+GovernorTest::decisions() {
+    VirtualClock clock(0);
+    ResourceGovernor governor(&clock, sysRoot.path());
+    governor.setThresholds(65.0, 75.0, 1.5, 50);
+    governor.setMaxEncoderThreads(4);
+    int  nEncoders = 4;
+    bool bPackingPaused  = false;
+    bool bEncodingPaused = false;
+    connect(&governor, &ResourceGovernor::encoderThreadsChanged, [&nEncoders](int n) {
+        nEncoders = n;
+    });
+    connect(&governor, &ResourceGovernor::packingPaused, [&bPackingPaused](bool b) {
+        bPackingPaused = b;
+    });
+    connect(&governor, &ResourceGovernor::encodingPaused, [&bEncodingPaused](bool b) {
+        bEncodingPaused = b;
+    });
+    governor.start(2000);
+    QCOMPARE(governor.level(), ResourceGovernor::Normal);
+
+    setTemperature(68.0);// Warm: at once
+    governor.sample();
+    QCOMPARE(governor.level(), ResourceGovernor::Reduced);
+    QCOMPARE(nEncoders, 2);
+    QVERIFY(bPackingPaused);
+    QVERIFY(!bEncodingPaused);
+
+    governor.reportLatency(120);// Very late: minimal
+    governor.sample();
+    QCOMPARE(governor.level(), ResourceGovernor::Minimal);
+    QCOMPARE(nEncoders, 1);
+    QVERIFY(bEncodingPaused);
+
+    setTemperature(62.0);// Below warm but within the hysteresis
+    governor.reportLatency(5);
+    for(int i=0; i<10; i++)
+        governor.sample();
+    QCOMPARE(governor.level(), ResourceGovernor::Reduced);
+    QVERIFY(!bEncodingPaused);
+
+    setTemperature(55.0);
+    for(int i=0; i<10; i++)
+        governor.sample();
+    QCOMPARE(governor.level(), ResourceGovernor::Normal);
+    QCOMPARE(nEncoders, 4);
+    QVERIFY(!bPackingPaused);
+
+    setLoad(2.0);// Busy, but cool and on time
+    governor.sample();
+    QCOMPARE(governor.level(), ResourceGovernor::Reduced);
+    governor.stop();
+    QCOMPARE(governor.level(), ResourceGovernor::Normal);
+    QCOMPARE(governor.stats().nChanges, 6);
+    setLoad(0.2);
+    setTemperature(45.0);
+}
@@ -0,0 +1,26 @@
+#ifndef GOVERNORTEST_H
+#define GOVERNORTEST_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+
+// The ResourceGovernor on a fake /sys and /proc: the decisions taken as
+// the temperature, the load and the lateness change.
+class GovernorTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void decisions();
+
+private:
+    void setTemperature(double celsius);
+    void setLoad(double load);
+
+private:
+    QTemporaryDir sysRoot;
+};
+
+#endif // GOVERNORTEST_H
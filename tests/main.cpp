@@ -0,0 +1,53 @@
+#include <QApplication>
+#include <QtTest>
+#include "clocktest.h"
+#include "configtest.h"
+#include "governortest.h"
+#include "mjpegparsertest.h"
+#include "replaytest.h"
+#include "syncnodetest.h"
+
+
+// The correctness tests, apart from the benchmarks so that "make check"
+// runs them in a few minutes and without timings:
+//
+//   tests [--only Class]... [QTest options]
+
+
+int
+main(int argc, char *argv[]) {
+    // The session replays build the main window: no display needed
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    // Never touch the settings of the real application
+    app.setApplicationName(QString("ImageSequence-tests"));
+
+    QStringList only;
+    QStringList testArguments;
+    QStringList arguments = app.arguments();
+    testArguments << arguments.first();
+    for(int i=1; i<arguments.size(); i++) {
+        if(arguments[i] == QString("--only") && i+1 < arguments.size())
+            only << arguments[++i];
+        else
+            testArguments << arguments[i];
+    }
+
+    QList<QObject*> tests;
+    tests << new ClockTest
+          << new ConfigTest
+          << new GovernorTest
+          << new MjpegParserTest
+          << new ReplayTest
+          << new SyncNodeTest;
+
+    int nFailed = 0;
+    for(int i=0; i<tests.size(); i++) {
+        if(!only.isEmpty() && !only.contains(QString(tests[i]->metaObject()->className())))
+            continue;
+        nFailed += QTest::qExec(tests[i], testArguments);
+    }
+    qDeleteAll(tests);
+    return (nFailed == 0) ? 0 : 1;
+}
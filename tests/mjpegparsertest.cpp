@@ -0,0 +1,100 @@
+#include "mjpegparsertest.h"
+#include <QtTest>
+#include "mjpegparser.h"
+#include "testframes.h"
+
+
+void
+MjpegParserTest::initTestCase() {
+    QImage image = TestFrames::noise(64, 48);
+    frame1 = TestFrames::jpeg(image);
+    image.setPixel(0, 0, qRgb(255, 255, 255));
+    frame2 = TestFrames::jpeg(image);
+    QVERIFY(frame1.startsWith("\xFF\xD8"));
+    QVERIFY(frame1 != frame2);
+}
+
+
+// The frames found, the stream arriving readSize bytes at a time
+QList<QByteArray>
+MjpegParserTest::split(const QByteArray& stream, int readSize) {
+    const unsigned char* pData = reinterpret_cast<const unsigned char*>(stream.constData());
+    MjpegParser parser;
+    QList<QByteArray> frames;
+    int iScanned = 0;
+    for(int iRead=0; iRead<stream.size(); ) {
+        iRead = qMin(stream.size(), iRead + readSize);
+        int iEnd;
+        while((iEnd = parser.scan(pData, iScanned, iRead)) > 0) {
+            frames.append(stream.mid(parser.frameStart(), iEnd-parser.frameStart()));
+            parser.reset();
+            iScanned = iEnd;
+        }
+        iScanned = iRead;
+    }
+    return frames;
+}
+
+
+// Every marker of the two frames is split at some point
+void
+MjpegParserTest::splitReads_data() {
+    QTest::addColumn<int>("readSize");
+    QTest::newRow("byte")  << 1;
+    QTest::newRow("odd")   << 7;
+    QTest::newRow("block") << 4096;
+    QTest::newRow("all")   << (1 << 20);
+}
+
+
+void
+MjpegParserTest::splitReads() {
+    QFETCH(int, readSize);
+    QList<QByteArray> frames = split(frame1 + frame2, readSize);
+    QCOMPARE(frames.size(), 2);
+    QCOMPARE(frames[0], frame1);
+    QCOMPARE(frames[1], frame2);
+}
+
+
+// An APP1 segment holding a whole JPEG (SOI...EOI) as the thumbnail
+void
+MjpegParserTest::exifThumbnail() {
+    QByteArray thumbnail = TestFrames::jpeg(TestFrames::noise(16, 12));
+    QByteArray app1 = QByteArray("Exif\0\0", 6) + thumbnail;
+    QByteArray segment("\xFF\xE1");
+    segment.append(char((app1.size()+2) >> 8));
+    segment.append(char((app1.size()+2) & 0xFF));
+    segment.append(app1);
+    QByteArray withExif = frame1;
+    withExif.insert(2, segment);// Right after the SOI
+    QList<QByteArray> frames = split(withExif + frame2, 1000);
+    QCOMPARE(frames.size(), 2);
+    QCOMPARE(frames[0], withExif);
+    QCOMPARE(frames[1], frame2);
+}
+
+
+// Stray 0xFF, stuffed bytes and an SOI not followed by a marker
+void
+MjpegParserTest::garbage() {
+    QByteArray junk("\x00\x12\xFF\x00junk\xFF\xFF\xFF\xD8\x42\xFF\xD9\x00", 16);
+    QList<QByteArray> frames = split(junk + frame1 + junk + frame2 + junk, 5);
+    QCOMPARE(frames.size(), 2);
+    QCOMPARE(frames[0], frame1);
+    QCOMPARE(frames[1], frame2);
+}
+
+
+// Cut between two segments of the headers or in the entropy coded data:
+// the next frame is found whole
+void
+MjpegParserTest::truncated() {
+    int iSecondSegment = 4 + ((uchar(frame1[4]) << 8) | uchar(frame1[5]));
+    QList<QByteArray> frames = split(frame1.left(iSecondSegment) + frame2, 64);
+    QCOMPARE(frames.size(), 1);
+    QCOMPARE(frames[0], frame2);
+    frames = split(frame1.left(frame1.size()-100) + frame2, 64);
+    QCOMPARE(frames.size(), 1);
+    QCOMPARE(frames[0], frame2);
+}
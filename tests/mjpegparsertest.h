@@ -0,0 +1,32 @@
+#ifndef MJPEGPARSERTEST_H
+#define MJPEGPARSERTEST_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+
+
+// The MjpegParser on the streams that corrupt a byte-scanning splitter:
+// markers split between two reads, an EOI inside the EXIF thumbnail,
+// garbage and truncated frames between the frames.
+class MjpegParserTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void splitReads_data();
+    void splitReads();
+    void exifThumbnail();
+    void garbage();
+    void truncated();
+
+private:
+    QList<QByteArray> split(const QByteArray& stream, int readSize);
+
+private:
+    QByteArray frame1;
+    QByteArray frame2;
+};
+
+#endif // MJPEGPARSERTEST_H
@@ -0,0 +1,41 @@
+#include "replaytest.h"
+#include <QtTest>
+#include "sessionreplay.h"
+
+
+// Recorders that crash or hang after n frames: every new recorder counts
+// its own, so they fail again and again
+void
+ReplayTest::session_data() {
+    QTest::addColumn<int>("msecInterval");
+    QTest::addColumn<int>("secDuration");
+    QTest::addColumn<bool>("bContinuous");
+    QTest::addColumn<int>("crashAfter");
+    QTest::addColumn<int>("hangAfter");
+    QTest::newRow("stills")           << 10000 << 600   << false << 0    << 0;
+    QTest::newRow("continuous")       << 500   << 60    << true  << 0    << 0;
+    QTest::newRow("stills-crash")     << 10000 << 6000  << false << 100  << 0;
+    QTest::newRow("stills-hang")      << 10000 << 6000  << false << 0    << 100;
+    QTest::newRow("continuous-crash") << 2000  << 1200  << true  << 100  << 0;
+    QTest::newRow("continuous-hang")  << 2000  << 1200  << true  << 0    << 100;
+    QTest::newRow("stills-24h-crash") << 10000 << 86400 << false << 1000 << 0;
+}
+
+
+// See SessionReplay::run() for what is checked on every frame
+void
+ReplayTest::session() {
+    QFETCH(int, msecInterval);
+    QFETCH(int, secDuration);
+    QFETCH(bool, bContinuous);
+    QFETCH(int, crashAfter);
+    QFETCH(int, hangAfter);
+    SessionReplay replay(msecInterval, secDuration, bContinuous);
+    replay.setCrashAfter(crashAfter);
+    replay.setHangAfter(hangAfter);
+    ReplayReport report;
+    QVERIFY2(replay.run(&report), qPrintable(report.failures.join(QString("; "))));
+    QVERIFY(report.nCaptured > 0);
+    if(crashAfter || hangAfter)// Recovered every time, not just once
+        QVERIFY(report.nIncidents >= report.nCaptured/(crashAfter + hangAfter) - 1);
+}
@@ -0,0 +1,19 @@
+#ifndef REPLAYTEST_H
+#define REPLAYTEST_H
+
+#include <QObject>
+
+
+// Whole sessions of the application with the simulated camera, replayed
+// on a VirtualClock (see SessionReplay): every frame is taken on time and
+// saved, and the recorders that crash or hang are replaced every time.
+class ReplayTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void session_data();
+    void session();
+};
+
+#endif // REPLAYTEST_H
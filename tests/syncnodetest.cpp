@@ -0,0 +1,46 @@
+#include "syncnodetest.h"
+#include <QtTest>
+#include "syncnode.h"
+
+
+#define OFFSET_TOLERANCE  5000  // in us: both nodes read the same clock
+
+
+void
+SyncNodeTest::loopback() {
+    SyncNode leader(SyncNode::Leader, QString("leader"));
+    QVERIFY(leader.listen(0));
+    SharedSchedule schedule;
+    schedule.sSessionId   = QString("{loopback}");
+    schedule.msecStart    = QDateTime::currentMSecsSinceEpoch() + 5000;
+    schedule.msecInterval = 2000;
+    schedule.secTotTime   = 3600;
+    schedule.bRunning     = true;
+    leader.setSchedule(schedule);
+
+    SyncNode follower(SyncNode::Follower, QString("follower"));
+    SharedSchedule received;
+    received.bRunning = false;
+    int nSchedules = 0;
+    connect(&follower, &SyncNode::scheduleReceived,
+            [&received, &nSchedules](const SharedSchedule& s) {
+                received = s;
+                nSchedules++;
+            });
+    qint64 usecOffset = OFFSET_TOLERANCE;
+    connect(&follower, &SyncNode::offsetChanged,
+            [&usecOffset](qint64 usecNewOffset) { usecOffset = usecNewOffset; });
+    QVERIFY(follower.follow(QHostAddress(QHostAddress::LocalHost), leader.localPort()));
+    QTRY_VERIFY(nSchedules > 0);
+
+    QVERIFY(follower.isSynchronized());
+    QCOMPARE(received.sSessionId, schedule.sSessionId);
+    QCOMPARE(received.msecStart, schedule.msecStart);
+    QCOMPARE(received.msecInterval, schedule.msecInterval);
+    QCOMPARE(received.secTotTime, schedule.secTotTime);
+    QVERIFY(received.bRunning);
+    QVERIFY2(qAbs(usecOffset) < OFFSET_TOLERANCE,
+             qPrintable(QString("offset %1 us").arg(usecOffset)));
+    QTRY_COMPARE(leader.nodes().size(), 1);
+    QCOMPARE(leader.nodes().first().sNode, QString("follower"));
+}
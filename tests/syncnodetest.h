@@ -0,0 +1,17 @@
+#ifndef SYNCNODETEST_H
+#define SYNCNODETEST_H
+
+#include <QObject>
+
+
+// A leader and a follower over loopback: the schedule gets through and,
+// on the same clock, the estimated offset is about zero.
+class SyncNodeTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void loopback();
+};
+
+#endif // SYNCNODETEST_H
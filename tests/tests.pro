@@ -0,0 +1,35 @@
+QT += core
+QT += gui
+QT += widgets
+QT += concurrent
+QT += network
+QT += testlib
+
+TARGET = tests
+TEMPLATE = app
+
+CONFIG += c++14
+CONFIG += console
+CONFIG += testcase  # "make check" runs them
+
+# The application, but its main()
+include(../ImageSequence.pri)
+
+INCLUDEPATH += $$PWD/../benchmarks  # The test frames
+
+SOURCES += main.cpp
+SOURCES += ../benchmarks/testframes.cpp
+SOURCES += clocktest.cpp
+SOURCES += configtest.cpp
+SOURCES += governortest.cpp
+SOURCES += mjpegparsertest.cpp
+SOURCES += replaytest.cpp
+SOURCES += syncnodetest.cpp
+
+HEADERS += ../benchmarks/testframes.h
+HEADERS += clocktest.h
+HEADERS += configtest.h
+HEADERS += governortest.h
+HEADERS += mjpegparsertest.h
+HEADERS += replaytest.h
+HEADERS += syncnodetest.h